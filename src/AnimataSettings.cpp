@@ -0,0 +1,50 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "AnimataSettings.h"
+
+using namespace Animata;
+
+/**
+ * Creates the settings with their default values.
+ **/
+AnimataSettings::AnimataSettings()
+{
+    mode = prevMode = ANIMATA_MODE_NONE;
+    fps = 30;
+
+    playSimulation = 1;
+    iteration = 40;
+    tolerance = 0;
+    relaxation = 1;
+    convergedSkinning = 1;
+    gpuSkinning = 0;
+    simulationRate = 30;
+
+    gravity = 0;
+    gravityForce = 1;
+    gravityX = 0;
+    gravityY = 1;
+
+    triangulateAlphaThreshold = 100;
+}
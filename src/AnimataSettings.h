@@ -0,0 +1,141 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __ANIMATASETTINGS_H__
+#define __ANIMATASETTINGS_H__
+
+namespace Animata
+{
+
+/**
+ * Operational modes set by pressing buttons on the GUI.
+ **/
+enum ANIMATA_MODES
+{
+    ANIMATA_MODE_NONE = 0,
+    /* mesh */
+    ANIMATA_MODE_CREATE_VERTEX,
+    ANIMATA_MODE_CREATE_TRIANGLE,
+    ANIMATA_MODE_TEXTURIZE,
+    ANIMATA_MODE_MESH_SELECT,
+    ANIMATA_MODE_MESH_DELETE,
+    /* skeleton */
+    ANIMATA_MODE_CREATE_JOINT,
+    ANIMATA_MODE_CREATE_BONE,
+    ANIMATA_MODE_ATTACH_VERTICES,
+    ANIMATA_MODE_SKELETON_SELECT,
+    ANIMATA_MODE_SKELETON_DELETE,
+    /* texture */
+    ANIMATA_MODE_TEXTURE_POSITION,
+    ANIMATA_MODE_TEXTURE_SCALE,
+    /* layer */
+    ANIMATA_MODE_LAYER_MOVE,
+    ANIMATA_MODE_LAYER_OFFSET,
+    ANIMATA_MODE_LAYER_SCALE,
+    ANIMATA_MODE_LAYER_DEPTH,
+    ANIMATA_MODE_LAYER_ROTATE_XY,
+    ANIMATA_MODE_LAYER_ROTATE_Z
+};
+
+inline bool isMeshMode(int mode)
+{
+    return (   mode >= ANIMATA_MODE_CREATE_VERTEX
+            && mode <= ANIMATA_MODE_MESH_DELETE);
+}
+
+inline bool isSkeletonMode(int mode)
+{
+    return (   mode >= ANIMATA_MODE_CREATE_JOINT
+            && mode <= ANIMATA_MODE_SKELETON_DELETE);
+}
+
+inline bool isTextureMode(int mode)
+{
+    return (   mode >= ANIMATA_MODE_TEXTURE_POSITION
+            && mode <= ANIMATA_MODE_TEXTURE_SCALE);
+}
+
+inline bool isLayerMode(int mode)
+{
+    return (   mode >= ANIMATA_MODE_LAYER_MOVE
+            && mode <= ANIMATA_MODE_LAYER_ROTATE_Z);
+}
+
+enum ANIMATA_DISPLAY_ELEMENTS
+{
+    DISPLAY_EDITOR_VERTEX = 0x01,
+    DISPLAY_EDITOR_TRIANGLE = 0x02,
+    DISPLAY_EDITOR_JOINT = 0x04,
+    DISPLAY_EDITOR_BONE = 0x08,
+    DISPLAY_EDITOR_TEXTURE = 0x10,
+    DISPLAY_OUTPUT_VERTEX = 0x10000,
+    DISPLAY_OUTPUT_TRIANGLE = 0x20000,
+    DISPLAY_OUTPUT_JOINT = 0x40000,
+    DISPLAY_OUTPUT_BONE = 0x80000,
+    DISPLAY_OUTPUT_TEXTURE = 0x100000
+};
+
+enum ANIMATA_RENDER_MODE
+{
+    RENDER_FEEDBACK = 0x01,
+    RENDER_OUTPUT = 0x04,
+    RENDER_TEXTURE = 0x10,
+    RENDER_WIREFRAME = 0x20
+};
+
+/// Various settings coming from the GUI.
+class AnimataSettings
+{
+public:
+    enum ANIMATA_MODES mode; /**< current operational mode */
+    enum ANIMATA_MODES prevMode; /**< previous operational mode */
+
+    int playSimulation; /**< whether to run simulation or not */
+    int gravity; /**< use gravity force */
+    float gravityForce; /**< strength of gravity */
+    float gravityX; /**< x component of the gravity direction vector */
+    float gravityY; /**< y component of the gravity direction vector */
+
+    int iteration; /**< number of times to run the simulation */
+    /** stop the simulation when no bone is further from its rest length,
+     * 0 to always run all iterations */
+    float tolerance;
+    float relaxation; /**< over-relaxation factor of the simulation */
+    /** pull attached vertices as far as the iterations run would instead
+     * of only once per frame */
+    int convergedSkinning;
+    /** skin the attached vertices in a vertex shader when drawing */
+    int gpuSkinning;
+    int fps; /**< frames per second */
+    int simulationRate; /**< simulation steps per second */
+    int display_elements; /**< flags to display elements in windows */
+
+    int triangulateAlphaThreshold; /**< triangulation threshold */
+
+    AnimataSettings();
+};
+
+} /* namespace Animata */
+
+#endif
+
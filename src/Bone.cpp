@@ -27,10 +27,13 @@
 #include <math.h>
 #include <assert.h>
 
+#include "Bone.h"
+
+#ifndef ANIMATA_HEADLESS
 #include "animata.h"
 #include "animataUI.h"
-#include "Bone.h"
 #include "Primitives.h"
+#endif
 
 using namespace Animata;
 
@@ -74,32 +77,6 @@ Bone::~Bone()
     delete attachedVertices;
 }
 
-/**
- * Runs the spring simulation on the bone.
- **/
-void Bone::simulate(void)
-{
-    if (tempo > 0) {
-        time += tempo / 42.0f;    // FIXME
-        animateLengthMult(0.5 + sin(time) * 0.5f);
-    }
-
-    Vector2D d(j1->position - j0->position);
-    float dCurrent = d.size();
-    d.normalize();
-
-    float m = ((dOrig * lengthMult) - dCurrent) * damp;
-
-    d *= m;
-    if (!j0->fixed && !j0->dragged) {
-        j0->position -= d;
-    }
-    if (!j1->fixed && !j1->dragged) {
-        j1->position += d;
-    }
-
-}
-
 /**
  * Sets bone length multiplier.
  * \param lm multiplier value
@@ -123,11 +100,19 @@ void Bone::setLengthMult(float lm)
 void Bone::animateLengthMult(float t)
 {
     lengthMult = lengthMultMin + (lengthMultMax - lengthMultMin) * t;
+}
 
-    // TODO: find a place for this call
-    if (selected) {
-        ui->boneLengthMult->value(lengthMult);
-    }
+/**
+ * Sets the oscillator time and the length multiplier resulting from it, as
+ * calculated by the simulation. Unlike animateBone() it does not touch the
+ * user interface, as it can be called from any thread.
+ * \param t oscillator time
+ * \param lm length multiplier
+ **/
+void Bone::setAnimationState(float t, float lm)
+{
+    time = t;
+    lengthMult = lm;
 }
 
 /**
@@ -146,28 +131,6 @@ void Bone::animateBone(float t)
     animateLengthMult(t);
 }
 
-/**
- * Translates attached vertices of bone.
- * Attached vertices try to maintain their relative position to
- * the bone centre.
- **/
-void Bone::translateVertices(void)
-{
-    Vector2D d(j1->position - j0->position);
-    d.normalize();
-    Vector2D c = getCenter();
-
-    for (unsigned i = 0; i < attachedVertices->size(); i++) {
-        Vertex *v = (*attachedVertices)[i];
-        Vector2D t;
-        t.x = c.x + (d.x * ca[i] - d.y * sa[i]);
-        t.y = c.y + (d.x * sa[i] + d.y * ca[i]);
-        t -= v->coord;
-        t *= weights[i];
-        v->coord += t;
-    }
-}
-
 /**
  * Moves bone by the given vector.
  * \param d distance vector
@@ -189,6 +152,7 @@ void Bone::release(void)
     j1->dragged = false;
 }
 
+#ifndef ANIMATA_HEADLESS
 /**
  * Draws bone.
  * \param mouseOver 1 if the mouse is over the bone
@@ -198,7 +162,6 @@ void Bone::draw(int mouseOver, int active)
 {
     Primitives::drawBone(this, mouseOver, active);
 
-    // FIXME: screws up selection
     if (ui->settings.mode == ANIMATA_MODE_ATTACH_VERTICES) {
         // cannot use getRadius(), as it isn't view-dependent
         int r = (int)(getViewRadius());
@@ -212,6 +175,7 @@ void Bone::draw(int mouseOver, int active)
         }
     }
 }
+#endif
 
 /**
  * Inverts the bone's state of selection.
@@ -45,13 +45,12 @@ public:
     Bone(Joint *j0, Joint *j1);
     ~Bone();
 
-    void simulate(void);
-    void translateVertices(void);
-
     void drag(const Vector2D& d, int timeStamp = 0);
     void release(void);
 
+#ifndef ANIMATA_HEADLESS
     void draw(int mouseOver, int active = 1);
+#endif
     void flipSelection(void);
 
     const char *getName(void) const;
@@ -106,6 +105,8 @@ public:
     inline float getTempo(void) const { return tempo; }
     /// Returns current time of oscillator.
     inline float getTime(void) const { return time; }
+    /// Updates the oscillator state after the simulation.
+    void setAnimationState(float t, float lm);
 
     /// Returns bone centre.
     Vector2D getCenter(void) const;
@@ -26,13 +26,12 @@
 
 #if defined(__APPLE__)
     #include <OPENGL/gl.h>
-    #include <OPENGL/glu.h>
 #else
     #include <GL/gl.h>
-    #include <GL/glu.h>
 #endif
 
 #include "Camera.h"
+#include "Transform.h"
 
 using namespace Animata;
 
@@ -61,6 +60,8 @@ Camera::Camera()
     init = false;
 
     parent = NULL;
+
+    viewport[0] = viewport[1] = viewport[2] = viewport[3] = 0;
 }
 
 /**
@@ -129,74 +130,117 @@ void Camera::setAspect(const Vector2D& d)
 }
 
 /**
- * Sets up the projection matrix by perspective transformation.
- * Also the viewport is set.
- * In the beginning the projection matrix gets cleared.
+ * Calculates the perspective projection matrix of the camera, the same as
+ * gluPerspective() would multiply onto the projection matrix.
+ * \retval Matrix the projection matrix
  */
-void Camera::setupPerspective()
+Matrix Camera::getPerspectiveMatrix() const
 {
-    glMatrixMode(GL_PROJECTION);
+    Matrix m;
 
-    glLoadIdentity();
-    gluPerspective(fov, aspect, zNear, zFar);
+    double f = 1.0 / tan(fov * M_PI / 360.0);
+    double depth = zNear - zFar;
 
-    setupViewport();
+    m[0] = f / aspect;
+    m[5] = f;
+    m[10] = (zFar + zNear) / depth;
+    m[11] = -1.f;
+    m[14] = 2.0 * zFar * zNear / depth;
+
+    return m;
 }
 
 /**
- * Sets up the projection matrix by orthographic transformation.
- * Also the viewport is set.
- * In the beginning the projection matrix gets cleared.
+ * Calculates the orthographic projection matrix of the camera, the same as
+ * glOrtho() would multiply onto the projection matrix.
+ * \retval Matrix the projection matrix
  */
-void Camera::setupOrtho()
+Matrix Camera::getOrthoMatrix() const
 {
-    glMatrixMode(GL_PROJECTION);
+    Matrix m;
 
-    glLoadIdentity();
     Vector2D p1 = (dim - pictureDim) * 0.5;
     Vector2D p2 = p1 + dim;
-    glOrtho(p1.x, p2.x, p1.y, p2.y, -1, 1);
 
-    setupViewport();
+    m[0] = 2.f / (p2.x - p1.x);
+    m[5] = 2.f / (p2.y - p1.y);
+    m[10] = -1.f;
+    m[12] = -(p2.x + p1.x) / (p2.x - p1.x);
+    m[13] = -(p2.y + p1.y) / (p2.y - p1.y);
+    m[15] = 1.f;
+
+    return m;
 }
 
 /**
- * Sets up the projection matrix which will be used by picking functions.
- * This is done via multiplying the a special picking matrix onto the current
- * projection matrix.
- * /param d         Coordinates of the picking position
- * /param radius    The radius around the given point where picking occures.
+ * Calculates the modelview matrix looking from \a distance at the \a target,
+ * the same as gluLookAt() would multiply onto the modelview matrix.
+ * \retval Matrix the modelview matrix
  */
-void Camera::setupPickingProjection(const Vector2D& p, int radius)
+Matrix Camera::getModelViewMatrix() const
 {
-    // get the boundaries of actual viewport
-    GLint viewport[4];
-    glGetIntegerv(GL_VIEWPORT, viewport);
+    Vector3D eye(target.x, target.y, target.z - distance);
+
+    Vector3D forward(target - eye);
+    forward.normalize();
+
+    Vector3D side(forward.y * upvector.z - forward.z * upvector.y,
+                  forward.z * upvector.x - forward.x * upvector.z,
+                  forward.x * upvector.y - forward.y * upvector.x);
+    side.normalize();
+
+    Vector3D up(side.y * forward.z - side.z * forward.y,
+                side.z * forward.x - side.x * forward.z,
+                side.x * forward.y - side.y * forward.x);
+
+    Matrix m;
+
+    m[0] = side.x;
+    m[4] = side.y;
+    m[8] = side.z;
+    m[1] = up.x;
+    m[5] = up.y;
+    m[9] = up.z;
+    m[2] = -forward.x;
+    m[6] = -forward.y;
+    m[10] = -forward.z;
+    m[12] = -(side.x * eye.x + side.y * eye.y + side.z * eye.z);
+    m[13] = -(up.x * eye.x + up.y * eye.y + up.z * eye.z);
+    m[14] = forward.x * eye.x + forward.y * eye.y + forward.z * eye.z;
+    m[15] = 1.f;
+
+    return m;
+}
 
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
+/**
+ * Sets up the projection matrix by perspective transformation.
+ * Also the viewport is set.
+ */
+void Camera::setupPerspective()
+{
+    Transform::loadProjection(getPerspectiveMatrix());
 
-    gluPickMatrix((GLdouble)p.x, (GLdouble)(viewport[3] - p.y), (GLdouble)radius,
-                  (GLdouble)radius, viewport);
+    setupViewport();
+}
 
-    Vector2D p1 = (dim - pictureDim) * 0.5;
-    Vector2D p2 = p1 + dim;
-    glOrtho(p1.x, p2.x, p1.y, p2.y, -1, 1);
+/**
+ * Sets up the projection matrix by orthographic transformation.
+ * Also the viewport is set.
+ */
+void Camera::setupOrtho()
+{
+    Transform::loadProjection(getOrthoMatrix());
+
+    setupViewport();
 }
 
 /**
- * Sets up the modelview matrix by gluLookAt(), based on the camera properties
- * \a target, \a distance and \a upvector.
- * In the beginning the modelview matrix gets cleared.
+ * Sets up the modelview matrix looking at the \a target from \a distance with
+ * the \a upvector.
  */
 void Camera::setupModelView()
 {
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-
-    gluLookAt(target.x, target.y, target.z - distance,
-              target.x, target.y, target.z,
-              upvector.x, upvector.y, upvector.z);
+    Transform::loadModelView(getModelViewMatrix());
 }
 
 /**
@@ -206,6 +250,10 @@ void Camera::setupViewport()
 {
     Vector2D p = (dim - pictureDim) * 0.5;
 
-    glViewport(p.x, p.y, pictureDim.x, pictureDim.y);
-}
+    viewport[0] = (int)p.x;
+    viewport[1] = (int)p.y;
+    viewport[2] = (int)pictureDim.x;
+    viewport[3] = (int)pictureDim.y;
 
+    Transform::loadViewport(viewport);
+}
@@ -25,6 +25,7 @@
 #define __CAMERA_H__
 
 #include "Vector3D.h"
+#include "Matrix.h"
 
 using namespace std;
 
@@ -55,6 +56,8 @@ private:
 
     bool init;              ///< shows if the camera target has already been set
 
+    int viewport[4];        ///< viewport set by setupViewport()
+
 public:
 
     Camera();
@@ -65,9 +68,18 @@ public:
     void setupModelView();
     void setupPerspective();
     void setupOrtho();
-    void setupPickingProjection(const Vector2D& center, int radius);
     void setupViewport();
 
+    Matrix getPerspectiveMatrix() const;
+    Matrix getOrthoMatrix() const;
+    Matrix getModelViewMatrix() const;
+
+    /**
+     * Returns the viewport last set by setupViewport().
+     * \retval const int* x, y position, width and height of the viewport
+     */
+    inline const int *getViewport() const { return viewport; }
+
     /**
      * Sets the parent camera to a given one.
      * This will show the same picture as the parent.
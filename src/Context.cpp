@@ -0,0 +1,272 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <stdio.h>
+#include <algorithm>
+
+#include "Context.h"
+#include "Layer.h"
+
+using namespace Animata;
+
+namespace Animata
+{
+    /** used until the application sets a context of its own */
+    static Context defaultContext;
+
+    Context *context = &defaultContext;
+}
+
+/**
+ * Makes the given context the current one.
+ * \param c pointer to context, NULL to return to the default context
+ **/
+void Animata::setContext(Context *c)
+{
+    context = c ? c : &defaultContext;
+}
+
+/**
+ * Creates a context with the default settings and no elements.
+ **/
+Context::Context()
+{
+    settings = &defaultSettings;
+
+    allLayers = new vector<Layer *>;
+    layerOrderDirty = false;
+    allBones = new vector<Bone *>;
+    allJoints = new vector<Joint *>;
+    oscJoints = new vector<Joint *>;
+
+    /* recursive, as deleting a layer locks again while the scene is
+     * locked for editing */
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    frameDirty = true;
+    pthread_mutex_init(&frameMutex, NULL);
+}
+
+Context::~Context()
+{
+    if (context == this)
+        setContext(NULL);
+
+    delete allLayers;
+    delete allBones;
+    delete allJoints;
+    delete oscJoints;
+
+    pthread_mutex_destroy(&mutex);
+    pthread_mutex_destroy(&frameMutex);
+}
+
+void Context::addToAllLayers(Layer *l)
+{
+    allLayers->push_back(l);
+    layerOrderDirty = true;
+    invalidateFrame();
+}
+
+/**
+ * Updates the transformation matrices and accumulated alpha of all layers
+ * in one pass down from the root layers, only the ones changed since the
+ * last update are calculated again. If the depth of a layer has changed or
+ * layers were added, the layers are sorted by their depth again.
+ * \sa Layer::updateTransformation()
+ **/
+void Context::updateTransformations(void)
+{
+    vector<Layer *>::iterator l = allLayers->begin();
+    for (; l < allLayers->end(); l++) {
+        if ((*l)->getParent() == NULL)
+            (*l)->updateTransformation();
+    }
+
+    if (layerOrderDirty)
+        sortLayers();
+}
+
+/**
+ * Sorts the layers by their total depth with insertion sort. The layers are
+ * sorted from the last time, only the ones moved in depth since then are
+ * out of order, so this takes linear time unless many of them pass each
+ * other. Layers with the same depth keep their order.
+ * \sa Layer::zorder()
+ **/
+void Context::sortLayers(void)
+{
+    vector<Layer *>& layers = *allLayers;
+
+    for (unsigned i = 1; i < layers.size(); i++) {
+        Layer *l = layers[i];
+        unsigned j = i;
+        for (; (j > 0) && Layer::zorder(l, layers[j - 1]); j--)
+            layers[j] = layers[j - 1];
+        layers[j] = l;
+    }
+
+    layerOrderDirty = false;
+}
+
+/**
+ * Deletes layer from vector of all layers.
+ * \param layer pointer to layer
+ **/
+void Context::deleteFromAllLayers(Layer *layer)
+{
+    vector<Layer *>::iterator pos;
+
+    // find position of layer in vector
+    pos = std::find(allLayers->begin(), allLayers->end(), layer);
+    if (pos == allLayers->end()) {
+        // not a member
+        fprintf(stderr, "error deleting %s (%p)\n", layer->getName(), layer);
+
+        return;
+    }
+
+    allLayers->erase(pos);
+    invalidateFrame();
+}
+
+/**
+ * Deletes bone from vector of all bones.
+ * \param bone pointer to bone
+ **/
+void Context::deleteFromAllBones(Bone *bone)
+{
+    vector<Bone *>::iterator pos;
+
+    // find position of bone in vector
+    pos = std::find(allBones->begin(), allBones->end(), bone);
+    if (pos == allBones->end()) // not a member
+        return;
+
+    allBones->erase(pos);
+}
+
+/**
+ * Deletes joint from vector of all joints.
+ * \param joint pointer to joint
+ **/
+void Context::deleteFromAllJoints(Joint *joint)
+{
+    vector<Joint *>::iterator pos;
+
+    // find position of joint in vector
+    pos = std::find(allJoints->begin(), allJoints->end(), joint);
+    if (pos == allJoints->end()) // not a member
+        return;
+
+    allJoints->erase(pos);
+}
+
+/**
+ * Deletes joint from vector of OSC joints.
+ * \param joint pointer to joint
+ **/
+void Context::deleteFromOSCJoints(Joint *joint)
+{
+    vector<Joint *>::iterator pos;
+
+    // find position of joint in vector
+    pos = std::find(oscJoints->begin(), oscJoints->end(), joint);
+    if (pos == oscJoints->end()) // not a member
+        return;
+
+    oscJoints->erase(pos);
+}
+
+/**
+ * Forgets all registered elements, called when the scene is erased.
+ **/
+void Context::clearElements(void)
+{
+    allLayers->clear();
+    allBones->clear();
+    allJoints->clear();
+    oscJoints->clear();
+    invalidateFrame();
+}
+
+/**
+ * Marks the scene changed since it was drawn the last time, so the windows
+ * are drawn again. Called from any thread when the layers, their poses or
+ * anything else shown changes.
+ * \sa validateFrame()
+ **/
+void Context::invalidateFrame(void)
+{
+    pthread_mutex_lock(&frameMutex);
+    frameDirty = true;
+    pthread_mutex_unlock(&frameMutex);
+}
+
+/**
+ * Marks the scene drawn, called before drawing a frame. Changes made while
+ * drawing invalidate the next frame.
+ * \return true if the scene has changed since the last call and has to be
+ * drawn again
+ **/
+bool Context::validateFrame(void)
+{
+    pthread_mutex_lock(&frameMutex);
+    bool dirty = frameDirty;
+    frameDirty = false;
+    pthread_mutex_unlock(&frameMutex);
+
+    return dirty;
+}
+
+/**
+ * Loads an image file as texture. The default context has no image loader
+ * and leaves meshes untextured.
+ * \param filename path of the image
+ * \return pointer to the new texture or NULL on failure
+ **/
+Texture *Context::loadTexture(const char *filename)
+{
+    return NULL;
+}
+
+/**
+ * Locks shared resources.
+ **/
+void Context::lock(void)
+{
+    pthread_mutex_lock(&mutex);
+}
+
+/**
+ * Unlocks shared resources.
+ **/
+void Context::unlock(void)
+{
+    pthread_mutex_unlock(&mutex);
+}
+
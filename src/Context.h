@@ -0,0 +1,153 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __CONTEXT_H__
+#define __CONTEXT_H__
+
+#include <pthread.h>
+#include <vector>
+
+#include "AnimataSettings.h"
+
+using namespace std;
+
+namespace Animata
+{
+
+class Layer;
+class Bone;
+class Joint;
+class Texture;
+
+/// Settings and bookkeeping shared by the elements of a scene.
+/**
+ * Layers, skeletons and the scene loader read the simulation settings from
+ * the current context and register their elements in it instead of talking
+ * to the user interface. The editor window is the context of the
+ * application, programs without a user interface create a Context and make
+ * it the current one with setContext().
+ **/
+class Context
+{
+public:
+    Context();
+    virtual ~Context();
+
+    /// Returns the settings of the simulation.
+    inline AnimataSettings *getSettings(void) { return settings; }
+    /// Sets the settings of the simulation, NULL for the default ones.
+    inline void setSettings(AnimataSettings *s)
+        { settings = s ? s : &defaultSettings; }
+
+    /**
+     * Adds layer to vector of all layers.
+     * \param l layer pointer to add
+     **/
+    void addToAllLayers(Layer *l);
+    void deleteFromAllLayers(Layer *layer);
+    /// Returns the vector storing all layers.
+    inline vector<Layer *> *getAllLayers() { return allLayers; }
+    /// Updates the transformation matrices of all layers.
+    void updateTransformations(void);
+    /**
+     * Makes the next updateTransformations() sort the layers by their depth,
+     * called when the total depth of a layer changes.
+     **/
+    inline void invalidateLayerOrder(void) { layerOrderDirty = true; }
+
+    void invalidateFrame(void);
+    bool validateFrame(void);
+
+    /** Adds bone to vector of all bones.
+     * \param b bone pointer to add
+     **/
+    inline void addToAllBones(Bone *b) { allBones->push_back(b); }
+    void deleteFromAllBones(Bone *bone);
+    /// Returns the vector storing all bones.
+    inline vector<Bone *> *getAllBones() { return allBones; }
+
+    /** Adds joint to vector of all joints.
+     * \param j joint pointer to add
+     **/
+    inline void addToAllJoints(Joint *j) { allJoints->push_back(j); }
+    /// Deletes joint from the vector of all joints.
+    void deleteFromAllJoints(Joint *joint);
+    /// Returns the vector storing all joints.
+    inline vector<Joint *> *getAllJoints() { return allJoints; }
+
+    /** Adds joint to vector of OSC joints.
+     * \param j joint pointer to add
+     **/
+    inline void addToOSCJoints(Joint *j) { oscJoints->push_back(j); }
+    /// Deletes joint from the vector of OSC joints.
+    void deleteFromOSCJoints(Joint *joint);
+    /// Returns the vector storing OSC joints.
+    inline vector<Joint *> *getOSCJoints() { return oscJoints; }
+
+    void clearElements(void);
+
+    virtual Texture *loadTexture(const char *filename);
+
+    void lock(void);
+    void unlock(void);
+
+private:
+    AnimataSettings defaultSettings;
+    AnimataSettings *settings;
+
+protected:
+    /* FIXME: use multimap instead of vectors and store only named elements */
+    /* the following vectors are needed to reach the elements quickly
+     * without traversing the whole hierarcy recursively */
+    /** vector of all layers without the hierarchical structure, sorted
+     * by depth from the farthest */
+    vector<Layer *> *allLayers;
+    /** set if the layers have to be sorted by depth again */
+    bool layerOrderDirty;
+    /** vector of all bones without the hierarchical structure */
+    vector<Bone *> *allBones;
+    /** vector of all joints without the hierarchical structure */
+    vector<Joint *> *allJoints;
+
+    /** vector of all joints needed to be send via OSC */
+    vector<Joint *> *oscJoints;
+
+private:
+    pthread_mutex_t mutex;
+
+    /** set if the scene has changed since it was drawn */
+    bool frameDirty;
+    pthread_mutex_t frameMutex;
+
+    void sortLayers(void);
+};
+
+/// The context scene elements register in.
+extern Context *context;
+
+void setContext(Context *c);
+
+} /* namespace Animata */
+
+#endif
+
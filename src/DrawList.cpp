@@ -0,0 +1,437 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "DrawList.h"
+#include "Transform.h"
+#include "animata.h"
+
+using namespace Animata;
+
+/**
+ * Creates an empty draw list.
+ **/
+DrawList::DrawList()
+{
+    cacheBuffer = new MeshBuffer();
+    cachedArea = 0;
+    frame = 0;
+}
+
+/**
+ * Deletes the buffers of the batches and the caches of the layers.
+ **/
+DrawList::~DrawList()
+{
+    for (unsigned i = 0; i < buffers.size(); i++)
+        delete buffers[i];
+
+    map<Layer *, Cache>::iterator c = caches.begin();
+    for (; c != caches.end(); c++)
+        delete c->second.cache;
+    delete cacheBuffer;
+}
+
+/**
+ * Projects the drawn layers and collects the ones with textured faces into
+ * \a nextItems. A layer is projected if its textured faces are drawn from
+ * the view coordinates, or if the view coordinates are needed for the
+ * wireframe. Static layers are not projected for their textured faces, they
+ * are drawn from their caches.
+ * \param layers    layers in drawing order
+ * \param mode      drawing mode, see Mesh::draw()
+ **/
+void DrawList::collect(vector<Layer *> *layers, int mode)
+{
+    nextItems.clear();
+    projections.clear();
+    coords.clear();
+
+    for (unsigned i = 0; i < layers->size(); i++) {
+        Layer *layer = (*layers)[i];
+        if (!layer->isDrawn(mode))
+            continue;
+
+        Mesh *mesh = layer->getMesh();
+        mesh->setTextureAlpha(layer->getAccumulatedAlpha());
+
+        bool skinned = mesh->updateSkinning();
+        bool textured = mesh->isTextureShown(mode);
+        bool viewNeeded = mode & (RENDER_FEEDBACK | RENDER_WIREFRAME);
+
+        if (!textured && !viewNeeded)
+            continue;
+
+        /* set the transformation matrices for projectVertices() and
+         * projectJoints(), for the skinning shader or for the cache */
+        Transform::setMatrices(layer->getTransformationMatrix());
+
+        Item item;
+        item.cache = NULL;
+        if (textured) {
+            MeshBuffer::selectTexture(mesh->getVertices(),
+                                      mesh->getAttachedTexture(),
+                                      &item.texture, item.region);
+            if (!skinned)
+                item.cache = getCache(layer, item.texture, item.region);
+        }
+
+        bool projected = viewNeeded ||
+                         (textured && !skinned &&
+                          !(item.cache && item.cache->isRendered()));
+
+        unsigned points = 0;
+        if (projected) {
+            points = project(layer);
+            if (mode & RENDER_FEEDBACK)
+                publish(projections.back());
+        }
+
+        if (!textured)
+            continue;
+
+        if (item.cache && !item.cache->isRendered() &&
+            !renderCache(item.cache, mesh, points))
+            item.cache = NULL;
+
+        item.layer = layer;
+        item.alpha = mesh->getTextureAlpha();
+        item.skinned = skinned;
+        item.points = points;
+        if (skinned) {
+            Transform::getViewMatrix(item.view);
+            Transform::getViewport(item.viewport);
+        }
+
+        nextItems.push_back(item);
+    }
+
+    deleteUnusedCaches();
+    frame++;
+}
+
+/**
+ * Projects the vertices and joints of a layer with the transformation
+ * matrices set by Transform::setMatrices().
+ * \param layer     the projected layer
+ * \retval unsigned index of the vertex view coordinates in \a coords
+ **/
+unsigned DrawList::project(Layer *layer)
+{
+    Mesh *mesh = layer->getMesh();
+    Skeleton *skeleton = layer->getSkeleton();
+
+    Projection projection;
+    projection.layer = layer;
+    projection.vertexCount = mesh->getVertices()->size();
+    projection.jointCount = skeleton->getJoints()->size();
+    projection.vertices = coords.size();
+    projection.joints = projection.vertices + projection.vertexCount * 2;
+    projection.meshRevision = mesh->getRevision();
+    projection.skeletonRevision = skeleton->getRevision();
+
+    coords.resize(projection.joints + projection.jointCount * 2);
+    if (projection.vertexCount)
+        mesh->projectVertices(&coords[projection.vertices]);
+    if (projection.jointCount)
+        skeleton->projectJoints(&coords[projection.joints]);
+
+    projections.push_back(projection);
+
+    return projection.vertices;
+}
+
+/**
+ * Finds or creates the cache of a layer with a textured mesh which is not
+ * skinned, and compares the layer to the last frame. Layers with less than
+ * LayerCache::MIN_FACES faces are not cached, as drawing the cache costs
+ * about as much as drawing their faces.
+ * \param layer     the drawn layer
+ * \param texture   OpenGL texture the mesh is drawn with
+ * \param region    offset and size of the texture on it
+ * \retval LayerCache* the cache to draw the layer from, or NULL if the layer
+ *                     is not static
+ **/
+LayerCache *DrawList::getCache(Layer *layer, GLuint texture,
+                               const float *region)
+{
+    Mesh *mesh = layer->getMesh();
+    if ((mesh->getFaces()->size() < LayerCache::MIN_FACES) ||
+        !LayerCache::isAvailable())
+        return NULL;
+
+    map<Layer *, Cache>::iterator c = caches.find(layer);
+    if (c == caches.end()) {
+        Cache cache;
+        cache.cache = new LayerCache();
+        c = caches.insert(make_pair(layer, cache)).first;
+    }
+    c->second.frame = frame;
+
+    LayerCache *cache = c->second.cache;
+    return cache->update(mesh, texture, region) ? cache : NULL;
+}
+
+/**
+ * Renders a static layer into its cache, if the caches together are not
+ * larger than \c CACHE_SCREENS viewports with it.
+ * \param cache     cache of the layer
+ * \param mesh      mesh of the layer
+ * \param points    index of the vertex view coordinates in \a coords
+ * \retval bool false if the layer has to be drawn face by face
+ **/
+bool DrawList::renderCache(LayerCache *cache, Mesh *mesh, unsigned points)
+{
+    float viewport[4];
+    Transform::getViewport(viewport);
+
+    unsigned maxArea = CACHE_SCREENS * (unsigned)(viewport[2] * viewport[3]);
+    unsigned area = cachedArea - cache->getArea();
+    if (area >= maxArea)
+        return false;
+
+    if (!cache->render(mesh, &coords[points], cacheBuffer, maxArea - area))
+        return false;
+
+    cachedArea = area + cache->getArea();
+    return true;
+}
+
+/**
+ * Deletes the caches of the layers which were not drawn in the current
+ * frame, and sums up the size of the others.
+ **/
+void DrawList::deleteUnusedCaches(void)
+{
+    cachedArea = 0;
+
+    map<Layer *, Cache>::iterator c = caches.begin();
+    while (c != caches.end()) {
+        if (c->second.frame != frame) {
+            delete c->second.cache;
+            caches.erase(c++);
+        }
+        else {
+            cachedArea += c->second.cache->getArea();
+            c++;
+        }
+    }
+}
+
+/**
+ * Returns the view coordinates of the vertices of a projected layer.
+ * \param projection    the projected layer
+ * \retval const float* the coordinates, or NULL if the mesh has no vertices
+ *                      or has changed since the projection
+ **/
+const float *DrawList::getVertexPoints(const Projection& projection)
+{
+    Mesh *mesh = projection.layer->getMesh();
+
+    if (projection.vertexCount &&
+        (mesh->getVertices()->size() == projection.vertexCount) &&
+        (mesh->getRevision() == projection.meshRevision))
+        return &coords[projection.vertices];
+
+    return NULL;
+}
+
+/**
+ * Returns the view coordinates of the joints of a projected layer.
+ * \param projection    the projected layer
+ * \retval const float* the coordinates, or NULL if the skeleton has no joints
+ *                      or has changed since the projection
+ **/
+const float *DrawList::getJointPoints(const Projection& projection)
+{
+    Skeleton *skeleton = projection.layer->getSkeleton();
+
+    if (projection.jointCount &&
+        (skeleton->getJoints()->size() == projection.jointCount) &&
+        (skeleton->getRevision() == projection.skeletonRevision))
+        return &coords[projection.joints];
+
+    return NULL;
+}
+
+/**
+ * Copies the view coordinates of a projected layer into its vertices and
+ * joints. Nothing is copied into the mesh or the skeleton if it has changed
+ * since the projection.
+ * \param projection    the projected layer
+ **/
+void DrawList::publish(const Projection& projection)
+{
+    const float *vertexPoints = getVertexPoints(projection);
+    if (vertexPoints)
+        projection.layer->getMesh()->setVertexViewCoords(vertexPoints);
+
+    const float *jointPoints = getJointPoints(projection);
+    if (jointPoints)
+        projection.layer->getSkeleton()->setJointViewCoords(jointPoints);
+}
+
+/**
+ * Draws the wireframe of the layers projected in the last frame from the view
+ * coordinates of this draw list, over all the textured faces. The vertices
+ * and joints keep the view coordinates of the editor, which are used for
+ * picking.
+ **/
+void DrawList::drawWireframe(void)
+{
+    for (unsigned i = 0; i < projections.size(); i++) {
+        const Projection& projection = projections[i];
+        projection.layer->drawWireframe(getVertexPoints(projection),
+                                        getJointPoints(projection));
+    }
+}
+
+/**
+ * Checks whether the collected items would be batched differently than the
+ * ones of the last frame.
+ * \retval bool true if the batches have to be built again
+ **/
+bool DrawList::hasChanged(void)
+{
+    if (nextItems.size() != items.size())
+        return true;
+
+    for (unsigned i = 0; i < items.size(); i++) {
+        const Item& a = items[i];
+        const Item& b = nextItems[i];
+        if ((a.layer != b.layer) || (a.texture != b.texture) ||
+            (a.alpha != b.alpha) || (a.skinned != b.skinned) ||
+            (a.cache != b.cache))
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * Groups the consecutive items drawn with the same texture and alpha into
+ * batches. Skinned and cached items are drawn on their own.
+ **/
+void DrawList::buildBatches(void)
+{
+    batches.clear();
+
+    for (unsigned i = 0; i < items.size(); i++) {
+        const Item& item = items[i];
+
+        if (!batches.empty() && !item.skinned && !item.cache) {
+            Batch& last = batches.back();
+            const Item& prev = items[last.first];
+            if (!prev.skinned && !prev.cache &&
+                (prev.texture == item.texture) &&
+                (prev.alpha == item.alpha)) {
+                last.count++;
+                continue;
+            }
+        }
+
+        Batch batch;
+        batch.first = i;
+        batch.count = 1;
+        batches.push_back(batch);
+    }
+
+    while (buffers.size() < batches.size())
+        buffers.push_back(new MeshBuffer());
+}
+
+/**
+ * Projects the layers and draws their textured faces. The view coordinates
+ * are copied into the vertices and joints if the mode includes
+ * \c RENDER_FEEDBACK, and kept for drawWireframe() if it includes
+ * \c RENDER_WIREFRAME. The camera matrices have to be loaded through
+ * Transform.
+ * \param layers    layers in drawing order
+ * \param mode      drawing mode, see Mesh::draw()
+ **/
+void DrawList::draw(vector<Layer *> *layers, int mode)
+{
+    collect(layers, mode);
+
+    bool changed = hasChanged();
+    items.swap(nextItems);
+    if (changed)
+        buildBatches();
+
+    if (items.empty())
+        return;
+
+    // get the boundaries of actual viewport
+    float viewport[4];
+    Transform::getViewport(viewport);
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(viewport[0], viewport[2] + viewport[0], viewport[1],
+            viewport[3] + viewport[1], 0, 1);
+
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    glEnable(GL_TEXTURE_2D);
+
+    for (unsigned b = 0; b < batches.size(); b++) {
+        const Batch& batch = batches[b];
+        const Item& first = items[batch.first];
+
+        if (first.skinned) {
+            first.layer->getMesh()->drawSkinned(first.view, first.viewport);
+            continue;
+        }
+
+        if (first.cache) {
+            first.cache->draw();
+            continue;
+        }
+
+        glBindTexture(GL_TEXTURE_2D, first.texture);
+        glColor4f(1.f, 1.f, 1.f, first.alpha);
+
+        MeshBuffer *buffer = buffers[b];
+        buffer->clear();
+        for (unsigned i = batch.first; i < batch.first + batch.count; i++) {
+            Mesh *mesh = items[i].layer->getMesh();
+            buffer->add(mesh->getVertices(), mesh->getFaces(),
+                        mesh->getRevision(), items[i].region,
+                        coords.empty() ? NULL : &coords[0] + items[i].points);
+        }
+        buffer->draw();
+    }
+
+    glColor3f(1.f, 1.f, 1.f);
+    glDisable(GL_TEXTURE_2D);
+
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+
+    glMatrixMode(GL_MODELVIEW);
+}
@@ -0,0 +1,148 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __DRAWLIST_H__
+#define __DRAWLIST_H__
+
+#if defined(__APPLE__)
+#include <OPENGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <vector>
+#include <map>
+
+#include "Layer.h"
+#include "MeshBuffer.h"
+#include "LayerCache.h"
+
+using namespace std;
+
+namespace Animata
+{
+
+/// Draws the textured meshes of the layers in batches.
+/**
+ * The layers are projected one by one, then their textured faces are drawn
+ * in window coordinates with a single projection set up for all of them.
+ * Consecutive layers drawn with the same OpenGL texture and alpha, such as
+ * layers with textures on the same TextureAtlas page, are merged into a
+ * batch drawn from one MeshBuffer. The batches are kept from frame to frame
+ * and only formed again when the drawn layers, their order, textures or
+ * alpha change. Meshes skinned in SkinShader are drawn one by one.
+ *
+ * Layers with many faces which have not changed for a few frames are
+ * rendered into a LayerCache and drawn from it as a single quad, without
+ * projecting them, until they change again. The caches of the layers not
+ * drawn in a frame are deleted.
+ *
+ * Every window has its own draw list, which keeps the view coordinates of the
+ * vertices and joints projected with the camera of the window. These are
+ * only copied into the vertices and joints when drawing in
+ * \c RENDER_FEEDBACK mode, other windows draw their wireframe with
+ * drawWireframe(), so the windows don't overwrite each other's view
+ * coordinates.
+ **/
+class DrawList
+{
+public:
+    DrawList();
+    ~DrawList();
+
+    void draw(vector<Layer *> *layers, int mode);
+    void drawWireframe(void);
+
+private:
+    /// A layer with its textured faces drawn.
+    struct Item
+    {
+        Layer *layer;
+        GLuint texture;     ///< OpenGL texture the mesh is drawn with
+        float region[4];    ///< offset and size of the texture on it
+        float alpha;        ///< alpha of the texture
+        bool skinned;       ///< set if the mesh is skinned in the shader
+        float view[16];     ///< view matrix of a skinned layer
+        float viewport[4];  ///< viewport of a skinned layer
+        unsigned points;    ///< index of the vertex view coordinates
+        LayerCache *cache;  ///< cache the layer is drawn from, or NULL
+    };
+
+    /// Cache of a layer.
+    struct Cache
+    {
+        LayerCache *cache;
+        unsigned frame;     ///< last frame the layer was drawn in
+    };
+
+    /// View coordinates of a projected layer.
+    struct Projection
+    {
+        Layer *layer;
+        unsigned vertices;  ///< index of the vertex view coordinates
+        unsigned joints;    ///< index of the joint view coordinates
+        unsigned vertexCount;       ///< number of the projected vertices
+        unsigned jointCount;        ///< number of the projected joints
+        unsigned meshRevision;      ///< revision of the projected mesh
+        unsigned skeletonRevision;  ///< revision of the projected skeleton
+    };
+
+    /// Consecutive items drawn together.
+    struct Batch
+    {
+        unsigned first;     ///< index of the first item
+        unsigned count;     ///< number of items
+    };
+
+    vector<Item> items;         ///< layers drawn in the last frame
+    vector<Item> nextItems;     ///< layers collected for the current frame
+    vector<Batch> batches;      ///< batches of the items
+    vector<MeshBuffer *> buffers;   ///< buffers of the batches
+
+    vector<Projection> projections; ///< layers projected in the last frame
+    vector<float> coords;   ///< view coordinates of the projections
+
+    /// maximum size of the caches in viewports
+    static const unsigned CACHE_SCREENS = 4;
+
+    map<Layer *, Cache> caches; ///< caches of the drawn layers
+    MeshBuffer *cacheBuffer;    ///< buffer the caches are rendered from
+    unsigned cachedArea;        ///< number of pixels of the caches
+    unsigned frame;             ///< number of frames collected
+
+    void collect(vector<Layer *> *layers, int mode);
+    unsigned project(Layer *layer);
+    LayerCache *getCache(Layer *layer, GLuint texture, const float *region);
+    bool renderCache(LayerCache *cache, Mesh *mesh, unsigned points);
+    void deleteUnusedCaches(void);
+    const float *getVertexPoints(const Projection& projection);
+    const float *getJointPoints(const Projection& projection);
+    void publish(const Projection& projection);
+    bool hasChanged(void);
+    void buildBatches(void);
+};
+
+} /* namespace Animata */
+
+#endif
+
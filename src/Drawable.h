@@ -34,6 +34,7 @@ public:
 
     virtual ~Drawable() {}
 
+#ifndef ANIMATA_HEADLESS
     /**
      * Pure virtual function for drawing the primitive.
      * \param mode      Various rendering modes implemented by children classes.
@@ -63,6 +64,7 @@ public:
      */
     virtual void circleSelect(unsigned i, int type, const Vector2D& center,
                               float r) = 0;
+#endif
 };
 
 } /* namespace Animata */
@@ -40,9 +40,6 @@ Vector2D Face::center(void)
 
 void Face::attachTexture(Texture *t)
 {
-    GLint viewport[4];
-    glGetIntegerv(GL_VIEWPORT, viewport);
-
     float scale = t->getScale();
 
     Vector2D s = t->dimensions * scale;
@@ -21,12 +21,14 @@
 
 */
 
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
 #include <libgen.h> // basename, dirname
 #include <algorithm>
 #include <iterator>
 
-#include "animata.h"
-#include "animataUI.h"
+#include "Context.h"
 #include "IO.h"
 
 using namespace Animata;
@@ -347,7 +349,7 @@ void IO::loadSkeleton(TiXmlNode *parent, Skeleton *skeleton, Mesh *m)
         // add or remove the joint from the vector of joints
         // needed to be sent via OSC
         if (osc) {
-            ui->editorBox->addToOSCJoints(joint);
+            context->addToOSCJoints(joint);
         }
     }
     // skip the loading of bones if there was a problematic joint
@@ -549,17 +551,15 @@ void IO::loadTexture(TiXmlNode *textureNode, Mesh *mesh)
     QUERY_ATTR(t, "y", pos.y, 0);
     QUERY_ATTR(t, "scale", scale, 1.0);
 
-    // load image using fltk and add it to the texture manager
-    ImageBox *box = ui->loadImage(fullpath);
+    // load image through the context, the editor adds it to the texture
+    // manager
+    Texture *texture = context->loadTexture(fullpath);
     // TODO: error message box
-    if (box == NULL) {
+    if (texture == NULL) {
         fprintf(stderr, "error loading texture %s\n", fullpath);
         return;
     }
 
-    // add the texture to the texturemanager
-    Texture *texture = ui->editorBox->getTextureManager()->createTexture(box);
-
     // set texture parameters
     texture->position = pos;
     texture->setScale(scale);
@@ -25,9 +25,10 @@
 #include <string.h>
 #include <math.h>
 #include "Joint.h"
+
+#ifndef ANIMATA_HEADLESS
 #include "Primitives.h"
-#include "animata.h"
-#include "animataUI.h"
+#endif
 
 using namespace Animata;
 
@@ -66,16 +67,7 @@ void Joint::setName(const char *str)
     name[15] = 0;
 }
 
-/**
- * Runs the spring simulation on the joint.
- **/
-void Joint::simulate(void)
-{
-    if ((ui->settings.gravity == 1) & (!fixed) & (!dragged)) {
-        position += ui->settings.gravity * ui->settings.gravityForce;
-    }
-}
-
+#ifndef ANIMATA_HEADLESS
 /**
  * Draws joint.
  * \param mouseOver 1 if the mouse is over the bone
@@ -85,6 +77,7 @@ void Joint::draw(int mouseOver, int active)
 {
     Primitives::drawJoint(this, mouseOver, active);
 }
+#endif
 
 /**
  * Inverts the joint's state of selection.
@@ -52,8 +52,9 @@ public:
     const char *getName(void) const;
     void setName(const char *str);
 
-    void simulate(void);
+#ifndef ANIMATA_HEADLESS
     void draw(int dragged = 0, int active = 1);
+#endif
     void flipSelection(void);
 
     void drag(const Vector2D& d, int timeStamp = 0);
@@ -22,13 +22,18 @@
 */
 
 #include <stdio.h>
+#include <string.h>
 #include <float.h>
 #include <algorithm>
 
+#include "Context.h"
 #include "Layer.h"
+
+#ifndef ANIMATA_HEADLESS
 #include "animata.h"
 #include "animataUI.h"
 #include "Transform.h"
+#endif
 
 #define MIN_SCALE 0.1f
 
@@ -47,20 +52,24 @@ Layer::Layer(Layer *p)
 
     mesh = new Mesh();
     skeleton = new Skeleton();
+    mesh->setSkeleton(skeleton);
 
     sprintf(name, "layer_%04d", Layer::layerCount);
     Layer::layerCount++;
 
     alpha = 1.0;
     scale = 1.0;
+    accumulatedAlpha = 1.0;
 
     visible = true;
 
+    pthread_mutex_init(&transformationMutex, NULL);
+
+    updateBounds();
     calcTransformationMatrix();
 
     // add layer to vector of all layers
-    if (ui) // FIXME: ui should not be NULL ever!
-        ui->editorBox->addToAllLayers(this);
+    context->addToAllLayers(this);
 }
 
 /**
@@ -69,16 +78,16 @@ Layer::Layer(Layer *p)
 Layer::~Layer()
 {
     /* remove from all layers */
-    if (ui) {
-        ui->editorBox->lock();
-        ui->editorBox->deleteFromAllLayers(this);
-        ui->editorBox->unlock();
-    }
+    context->lock();
+    context->deleteFromAllLayers(this);
+    context->unlock();
 
     delete mesh;
     delete skeleton;
 
     eraseLayers();
+
+    pthread_mutex_destroy(&transformationMutex);
 }
 
 /**
@@ -169,50 +178,67 @@ void Layer::scaleAroundPoint(float s, const Vector3D& p)
 }
 
 
+#ifndef ANIMATA_HEADLESS
 /**
- * Draws layer.
+ * Checks whether the bounds of the layer can be seen with the camera whose
+ * matrices are loaded in Transform.
+ * \retval bool false if nothing of the layer is in the viewport
  **/
-void Layer::drawWithoutRecursion(int mode)
+bool Layer::isInView(void)
 {
-    if (!visible)
-        return;
+    if (boundsEmpty)
+        return false;
 
-    // get the boundaries of actual viewport
-    GLint viewport[4];
-    glGetIntegerv(GL_VIEWPORT, viewport);
+    return Transform::isVisible(transformation, boundsMin, boundsMax,
+                                VIEW_MARGIN);
+}
 
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glMultMatrixf(transformation.f);
+/**
+ * Checks whether the layer is drawn in the given mode. Layers behind the
+ * camera or out of the viewport are not drawn, neither the layers other than
+ * the current one in the editor in mesh and texture mode. The current layer
+ * is always drawn in the editor, as its view coordinates are needed for
+ * editing.
+ * \param mode  drawing mode, see Mesh::draw()
+ * \retval bool true if the layer is drawn
+ **/
+bool Layer::isDrawn(int mode)
+{
+    if (!visible)
+        return false;
 
     Camera *cam = ui->editorBox->getCamera();
     float camZ = cam->getTarget().z - cam->getDistance();
 
-    bool isCurrentLayer = this == ui->editorBox->getCurrentLayer();
-
     /* don't draw the layer if its behind the camera */
-    if (transformation[14] < camZ) {
-        glMatrixMode(GL_MODELVIEW);
-        glPopMatrix();
-        return;
-    }
+    if (transformation[14] < camZ)
+        return false;
+
+    if (((mode & RENDER_OUTPUT) ||
+         (this != ui->editorBox->getCurrentLayer())) && !isInView())
+        return false;
 
     /* If we are in mesh or image/texture mode, only draw the current layer */
     if ((isMeshMode(ui->settings.mode) || isTextureMode(ui->settings.mode))
-        && !isCurrentLayer && !(mode & RENDER_OUTPUT)) {
-        glMatrixMode(GL_MODELVIEW);
-        glPopMatrix();
-        return;
-    }
+        && (this != ui->editorBox->getCurrentLayer())
+        && !(mode & RENDER_OUTPUT))
+        return false;
 
-    mesh->setTextureAlpha(getAccumulatedAlpha());
+    return true;
+}
 
-    if (mode & RENDER_FEEDBACK) {
-        /* set the transformation matrices for setVertexViewCoords() and
-         * setJointViewCoords() in doFeedback */
-        Transform::setMatrices();
-        selector->doFeedback(this);
-    }
+/**
+ * Draws the wireframe of the layer from the view coordinates of its vertices
+ * and joints. The textured faces are drawn by DrawList.
+ **/
+void Layer::drawWithoutRecursion(int mode)
+{
+    if (!isDrawn(mode))
+        return;
+
+    // get the boundaries of actual viewport
+    float viewport[4];
+    Transform::getViewport(viewport);
 
     glMatrixMode(GL_PROJECTION);
     glPushMatrix();
@@ -224,10 +250,8 @@ void Layer::drawWithoutRecursion(int mode)
     glPushMatrix();
     glLoadIdentity();
 
-    mesh->draw(mode & ~RENDER_FEEDBACK,
-               this == ui->editorBox->getCurrentLayer());
-    skeleton->draw(mode & ~RENDER_FEEDBACK,
-                   this == ui->editorBox->getCurrentLayer());
+    mesh->draw(mode, this == ui->editorBox->getCurrentLayer());
+    skeleton->draw(mode, this == ui->editorBox->getCurrentLayer());
 
     glMatrixMode(GL_MODELVIEW);
     glPopMatrix();
@@ -235,55 +259,246 @@ void Layer::drawWithoutRecursion(int mode)
     glMatrixMode(GL_PROJECTION);
     glPopMatrix();
 
+    glMatrixMode(GL_MODELVIEW);
+}
+
+/**
+ * Draws the wireframe of the layer in the output window from view
+ * coordinates kept outside the vertices and joints, projected with the
+ * camera of the window.
+ * \param vertexPoints  x and y view coordinates of the vertices, or NULL to
+ *                      leave out the mesh
+ * \param jointPoints   x and y view coordinates of the joints, or NULL to
+ *                      leave out the skeleton
+ * \sa DrawList::drawWireframe()
+ **/
+void Layer::drawWireframe(const float *vertexPoints, const float *jointPoints)
+{
+    // get the boundaries of actual viewport
+    float viewport[4];
+    Transform::getViewport(viewport);
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(viewport[0], viewport[2] + viewport[0], viewport[1],
+            viewport[3] + viewport[1], 0, 1);
+
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    if (vertexPoints)
+        mesh->drawWireframe(vertexPoints);
+    if (jointPoints)
+        skeleton->drawWireframe(jointPoints, mesh->getVertices(),
+                                vertexPoints);
+
     glMatrixMode(GL_MODELVIEW);
     glPopMatrix();
+
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+
+    glMatrixMode(GL_MODELVIEW);
 }
+#endif
 
 /**
- * Run physical simulation on the skeleton of the layer and all sublayers.
- * \param times iteration count
+ * Simulates the skeleton of one layer, run by the ThreadPool.
+ **/
+class SkeletonTask : public Task
+{
+public:
+    SkeletonTask(Skeleton *s, int times) : skeleton(s), times(times) {}
+    virtual void run(void) { skeleton->simulate(times); }
+private:
+    Skeleton *skeleton;
+    int times;
+};
+
+/**
+ * Collects the skeletons of this layer and all visible sublayers.
+ * \param skeletons vector to append the skeletons to
  **/
-void Layer::simulate(int times)
+void Layer::getSimulatedSkeletons(vector<Skeleton *> *skeletons)
 {
     /* simulate only visible layers */
     if (!visible)
         return;
 
-    skeleton->simulate(times);
+    /* free joints fall under gravity even without bones */
+    if (!skeleton->getJoints()->empty())
+        skeletons->push_back(skeleton);
 
-    // simulate sublayers
     std::vector<Layer *>::iterator l = layers->begin();
     for (; l < layers->end(); l++)
-        (*l)->simulate(times);
+        (*l)->getSimulatedSkeletons(skeletons);
 }
 
 /**
- * Calculates the transformation matrix by traversing backwards the layer tree
- * and right multiplying its transformation matrices to the current matrix.
- * This way the transformation chain will be the same as in the opengl stack.
+ * Run physical simulation on the skeleton of the layer and all sublayers.
+ * Skeletons don't share joints, so they are simulated in parallel if a
+ * thread pool is given.
+ * \param times iteration count
+ * \param pool threads to run the simulation on, or NULL to run it on the
+ *        calling thread
+ **/
+void Layer::simulate(int times, ThreadPool *pool /* = NULL */)
+{
+    vector<Skeleton *> skeletons;
+    getSimulatedSkeletons(&skeletons);
+
+    if (pool == NULL) {
+        for (unsigned i = 0; i < skeletons.size(); i++)
+            skeletons[i]->simulate(times);
+        return;
+    }
+
+    vector<SkeletonTask> skeletonTasks;
+    skeletonTasks.reserve(skeletons.size());
+    vector<Task *> tasks;
+    for (unsigned i = 0; i < skeletons.size(); i++) {
+        skeletonTasks.push_back(SkeletonTask(skeletons[i], times));
+        tasks.push_back(&skeletonTasks.back());
+    }
+
+    pool->run(&tasks);
+}
+
+/**
+ * Publishes the current vertex and joint positions of this layer and all
+ * sublayers for drawing.
+ * \return true if any of the positions have changed since the last time
+ **/
+bool Layer::publishPose(void)
+{
+    /* the skeleton may move the attached vertices of the mesh */
+    bool changed = skeleton->publishPose();
+    changed = mesh->publishPose() || changed;
+
+    std::vector<Layer *>::iterator l = layers->begin();
+    for (; l < layers->end(); l++)
+        changed = (*l)->publishPose() || changed;
+
+    return changed;
+}
+
+/**
+ * Makes the latest published vertex and joint positions of this layer the
+ * ones to be drawn. Sublayers are not affected.
+ **/
+void Layer::latchPose(void)
+{
+    bool changed = mesh->latchPose();
+    changed = skeleton->latchPose() || changed;
+
+    if (changed || (boundsRevision[0] != mesh->getRevision()) ||
+        (boundsRevision[1] != skeleton->getRevision()))
+        updateBounds();
+}
+
+/**
+ * Calculates the bounding box of the latched pose of the mesh and the
+ * skeleton in the coordinate system of the layer.
+ * \sa isInView()
+ **/
+void Layer::updateBounds(void)
+{
+    Vector2D min, max;
+
+    boundsEmpty = true;
+    if (mesh->getPoseBounds(&min, &max)) {
+        boundsMin = min;
+        boundsMax = max;
+        boundsEmpty = false;
+    }
+    if (skeleton->getPoseBounds(&min, &max)) {
+        if (boundsEmpty) {
+            boundsMin = min;
+            boundsMax = max;
+            boundsEmpty = false;
+        }
+        else {
+            boundsMin.set(std::min(boundsMin.x, min.x),
+                          std::min(boundsMin.y, min.y));
+            boundsMax.set(std::max(boundsMax.x, max.x),
+                          std::max(boundsMax.y, max.y));
+        }
+    }
+
+    boundsRevision[0] = mesh->getRevision();
+    boundsRevision[1] = skeleton->getRevision();
+}
+
+/**
+ * Marks the transformation of the layer changed, the matrices of the layer
+ * and its sublayers are calculated again by the next updateTransformation(),
+ * and the scene is drawn again. Called from any thread after the position,
+ * offset, scale, angle or parent of the layer has been set.
+ **/
+void Layer::invalidateTransformation(void)
+{
+    pthread_mutex_lock(&transformationMutex);
+    transformationDirty = true;
+    pthread_mutex_unlock(&transformationMutex);
+
+    context->invalidateFrame();
+}
+
+/**
+ * Calculates the transformation matrix of this layer and its sublayers
+ * right away, from the current matrix of the parent.
+ * \sa updateTransformation()
  **/
 void Layer::calcTransformationMatrix()
 {
-    transformation.loadIdentity();
-    transformation.translate(offset * -1.0f);
-    transformation.scale(Vector3D(scale, scale, 1.0f));
-    transformation.rotate(angle);
-    transformation.translate(position + offset);
-
-    Layer *actLayer = this;
-    while (actLayer->getParent()) {
-        actLayer = actLayer->getParent();
-        transformation.translate(actLayer->getOffset() * -1.0f);
-        transformation.scale(Vector3D(actLayer->getScale(), actLayer->getScale(), 1.0f));
-        transformation.rotate(actLayer->getAngle());
-        transformation.translate(actLayer->getPosition() + actLayer->getOffset());
+    invalidateTransformation();
+    updateTransformation();
+}
+
+/**
+ * Updates the transformation matrices and the accumulated alpha of this
+ * layer and its sublayers in one pass down the layer tree. The local
+ * transformation is only calculated for layers marked by
+ * invalidateTransformation(), and the matrix right multiplied with the
+ * parent's matrix only for them and their sublayers. This way the
+ * transformation chain will be the same as in the opengl stack. The context
+ * is notified if the total depth of the layer changes.
+ * \param parentChanged set if the matrix of the parent has changed
+ **/
+void Layer::updateTransformation(bool parentChanged /* = false */)
+{
+    /* the flag is cleared before reading the fields, so a change made while
+     * they are read marks the layer again for the next update */
+    pthread_mutex_lock(&transformationMutex);
+    bool dirty = transformationDirty;
+    transformationDirty = false;
+    pthread_mutex_unlock(&transformationMutex);
+
+    bool changed = parentChanged || dirty;
+
+    if (dirty) {
+        localTransformation = Matrix(offset, Vector3D(scale, scale, 1.0f),
+                                     angle, position + offset);
+    }
+
+    if (changed) {
+        float depth = getTotalDepth();
+
+        transformation = localTransformation;
+        if (parent)
+            transformation *= parent->transformation;
+
+        if (getTotalDepth() != depth)
+            context->invalidateLayerOrder();
     }
 
-    // transformation matrix of this layer changed
-    // also recalculate transformation matrices of the sublayers
+    accumulatedAlpha = parent ? alpha * parent->accumulatedAlpha : alpha;
+
     std::vector<Layer *>::iterator l = layers->begin();
     for (; l < layers->end(); l++)
-        (*l)->calcTransformationMatrix();
+        (*l)->updateTransformation(changed);
 }
 
 
@@ -296,10 +511,13 @@ Layer *Layer::makeLayer()
 {
     Layer *l = new Layer(this);
 
+    /* the layer tree is traversed by the simulation thread */
+    context->lock();
     if (!layers)
         layers = new std::vector<Layer *>;
 
     layers->push_back(l);
+    context->unlock();
 
     return l;
 }
@@ -340,27 +558,15 @@ int Layer::deleteSublayer(Layer *layer)
     if (pos == layers->end()) // not a member
         return -1;
 
+    /* the layer tree is traversed by the simulation thread */
+    context->lock();
     layers->erase(pos);
     delete layer;
+    context->unlock();
 
     return 0;
 }
 
-/**
- * Returns alpha accumulated through the layer hierarchy.
- * The alpha value is multiplied by the parents' alpha.
- * \return layer alpha value
- **/
-float Layer::getAccumulatedAlpha(void) const
-{
-    if (parent == NULL) {
-        return alpha;
-    }
-    else {
-        return alpha * parent->getAccumulatedAlpha();
-    }
-}
-
 /**
  * Sets visibility recursively.
  * \param v visibility parameter
@@ -368,6 +574,7 @@ float Layer::getAccumulatedAlpha(void) const
 void Layer::setVisibility(bool v)
 {
     visible = v;
+    context->invalidateFrame();
 
     vector<Layer *>::iterator l = layers->begin();
     for (; l < layers->end(); l++)
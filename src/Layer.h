@@ -24,11 +24,15 @@
 #ifndef __LAYER_H__
 #define __LAYER_H__
 
+#include <pthread.h>
+
 #include "Skeleton.h"
 #include "Mesh.h"
 #include "Matrix.h"
 #include "Vector3D.h"
 #include "Angle3D.h"
+#include "ThreadPool.h"
+#include "Context.h"
 
 using namespace std;
 
@@ -63,6 +67,29 @@ private:
 
     /** transformation matrix returned by getTransformationMatrix() */
     Matrix transformation;
+    /** transformation of the layer relative to its parent */
+    Matrix localTransformation;
+    /** set if the local transformation has to be calculated again */
+    bool transformationDirty;
+    /** protects \a transformationDirty, as the layers are moved from other
+     * threads than the one drawing them */
+    pthread_mutex_t transformationMutex;
+
+    float accumulatedAlpha;         ///< alpha multiplied by the parents' alpha
+
+    Vector2D boundsMin;     ///< lower corner of the bounds of the latched pose
+    Vector2D boundsMax;     ///< upper corner of the bounds of the latched pose
+    bool boundsEmpty;       ///< set if there is nothing to draw on the layer
+    /** mesh and skeleton revisions the bounds were computed for */
+    unsigned boundsRevision[2];
+
+#ifndef ANIMATA_HEADLESS
+    /** pixels the wireframe of a layer reaches out of its bounds */
+    static const int VIEW_MARGIN = 16;
+#endif
+
+    void getSimulatedSkeletons(vector<Skeleton *> *skeletons);
+    void updateBounds(void);
 
 public:
 
@@ -85,9 +112,17 @@ public:
 
     int deleteSublayer(Layer *layer);
 
+#ifndef ANIMATA_HEADLESS
+    bool isInView(void);
+    bool isDrawn(int mode);
     void drawWithoutRecursion(int mode);
+    void drawWireframe(const float *vertexPoints, const float *jointPoints);
+#endif
+
+    void simulate(int times = 1, ThreadPool *pool = NULL);
 
-    void simulate(int times = 1);
+    bool publishPose(void);
+    void latchPose(void);
 
     /// makes a new layer
     Layer *makeLayer();
@@ -98,6 +133,10 @@ public:
      **/
     void calcTransformationMatrix();
 
+    void updateTransformation(bool parentChanged = false);
+
+    void invalidateTransformation(void);
+
     /**
      * Returns the transformation matrix of this layer.
      * \return pointer to the transformation matrix which is held in a static
@@ -117,7 +156,8 @@ public:
     /// Returns parent of layer.
     inline Layer *getParent() { return parent; }
     /// Sets layer parent.
-    inline void setParent(Layer *p) { parent = p; }
+    inline void setParent(Layer *p)
+        { parent = p; invalidateTransformation(); }
 
     /// Returns position.
     inline Vector3D getPosition(void) const { return position; }
@@ -135,40 +175,48 @@ public:
     /// Returns alpha.
     inline float getAlpha(void) const { return alpha; }
 
-    float getAccumulatedAlpha(void) const;
+    /**
+     * Returns alpha accumulated through the layer hierarchy, as of the last
+     * updateTransformation().
+     * \return layer alpha value
+     **/
+    inline float getAccumulatedAlpha(void) const { return accumulatedAlpha; }
 
     /// Returns visibility.
     inline bool getVisibility() const { return visible; }
 
     /// Sets x position.
     inline void setPosition(const Vector3D& v)
-        { this->position = v; /* calcTransformationMatrix(); */ }
+        { this->position = v; invalidateTransformation(); }
     inline void setPosition(const Vector2D& v)
-        { this->position = v; /* calcTransformationMatrix(); */ }
+        { this->position = v; invalidateTransformation(); }
     inline void setPositionElement(float value, int index)
-        { this->position.setElement(value, index); }
+        { this->position.setElement(value, index);
+          invalidateTransformation(); }
 
     /// Sets offset
     inline void setOffset(const Vector3D& v)
-        { this->offset = v; calcTransformationMatrix(); }
+        { this->offset = v; invalidateTransformation(); }
     inline void setOffset(const Vector2D& v)
-        { this->offset = v; calcTransformationMatrix(); }
+        { this->offset = v; invalidateTransformation(); }
     inline void setOffsetElement(float value, int index)
-        { this->offset.setElement(value, index); }
+        { this->offset.setElement(value, index);
+          invalidateTransformation(); }
 
         /// Sets scale.
     inline void setScale(float scale)
-        { this->scale = scale; calcTransformationMatrix(); }
+        { this->scale = scale; invalidateTransformation(); }
 
     /// Sets angle.
     inline void setAngle(const Angle3D& angle)
-        { this->angle = angle; calcTransformationMatrix(); }
+        { this->angle = angle; invalidateTransformation(); }
     inline void setAngleElement(float value, int index)
-        { this->angle.setElement(value, index); }
+        { this->angle.setElement(value, index);
+          invalidateTransformation(); }
 
     /// Sets alpha.
     inline void setAlpha(float alpha)
-        { this->alpha = alpha; }
+        { this->alpha = alpha; context->invalidateFrame(); }
     void setVisibility(bool v);
 
     /**
@@ -176,23 +224,23 @@ public:
      * \param d distance to move by
      **/
     inline void move(const Vector3D& d)
-        { this->position += d; calcTransformationMatrix(); }
+        { this->position += d; invalidateTransformation(); }
     inline void move(const Vector2D& d)
-        { this->position += d; calcTransformationMatrix(); }
+        { this->position += d; invalidateTransformation(); }
 
     /**
      * Resizes layer.
      * \param s value added to scale
      **/
     inline void resize(float s)
-        { this->scale += s; calcTransformationMatrix(); }
+        { this->scale += s; invalidateTransformation(); }
 
     /**
      * Rotates layer.
      * \param s value added to theta
      **/
     inline void rotate(const Angle3D& angle)
-        { this->angle += angle; calcTransformationMatrix(); }
+        { this->angle += angle; invalidateTransformation(); }
 
     void scaleAroundPoint(float s, const Vector3D& p);
 
@@ -0,0 +1,340 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/* framebuffer objects are part of OpenGL 3.0, separate blend functions of
+ * OpenGL 1.4 */
+#define GL_GLEXT_PROTOTYPES
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__APPLE__)
+#include <OPENGL/gl.h>
+#include <OPENGL/glext.h>
+#else
+#include <GL/gl.h>
+#include <GL/glext.h>
+#endif
+
+#include "LayerCache.h"
+#include "Transform.h"
+
+using namespace Animata;
+
+/**
+ * Creates an empty cache, the image is created when the layer is rendered
+ * into it.
+ **/
+LayerCache::LayerCache()
+{
+    revision = 0;
+    texture = 0;
+    memset(region, 0, sizeof(region));
+    alpha = 0;
+    memset(view, 0, sizeof(view));
+    memset(viewport, 0, sizeof(viewport));
+
+    staticFrames = 0;
+    rendered = false;
+
+    memset(rect, 0, sizeof(rect));
+    width = 0;
+    height = 0;
+    image = 0;
+    framebuffer = 0;
+}
+
+/**
+ * Deletes the image.
+ **/
+LayerCache::~LayerCache()
+{
+    release();
+}
+
+/**
+ * Checks once whether the OpenGL implementation supports framebuffer
+ * objects and textures of any size, either by being version 3.0 or later
+ * or by the ARB extension on OpenGL 2.0.
+ * \retval bool true if layers can be cached
+ **/
+bool LayerCache::isAvailable(void)
+{
+    static int supported = -1;
+
+    if (supported < 0) {
+        const char *version = (const char *)glGetString(GL_VERSION);
+        const char *extensions = (const char *)glGetString(GL_EXTENSIONS);
+        int major = 0;
+
+        if (version == NULL)
+            return false;
+
+        sscanf(version, "%d", &major);
+        supported = (major >= 3) ||
+                    ((major == 2) && extensions &&
+                     strstr(extensions, "GL_ARB_framebuffer_object"));
+    }
+
+    return supported;
+}
+
+/**
+ * Compares the layer to the last frame. The image is dropped if anything
+ * its textured faces are drawn from has changed. The transformation
+ * matrices of the layer have to be set by Transform::setMatrices().
+ * \param mesh      mesh of the layer
+ * \param texture   OpenGL texture the mesh is drawn with
+ * \param region    offset and size of the texture on it, see
+ *                  MeshBuffer::selectTexture()
+ * \retval bool true if the layer is static and has to be drawn from the
+ *              cache, after calling render() if it is not rendered yet
+ **/
+bool LayerCache::update(Mesh *mesh, GLuint texture, const float *region)
+{
+    float view[16];
+    float viewport[4];
+    Transform::getViewMatrix(view);
+    Transform::getViewport(viewport);
+    mesh->getTexturedPose(&nextPose);
+
+    if ((this->texture != texture) || (revision != mesh->getRevision()) ||
+        (alpha != mesh->getTextureAlpha()) ||
+        memcmp(this->region, region, sizeof(this->region)) ||
+        memcmp(this->view, view, sizeof(view)) ||
+        memcmp(this->viewport, viewport, sizeof(viewport)) ||
+        (pose != nextPose)) {
+        this->texture = texture;
+        revision = mesh->getRevision();
+        alpha = mesh->getTextureAlpha();
+        memcpy(this->region, region, sizeof(this->region));
+        memcpy(this->view, view, sizeof(view));
+        memcpy(this->viewport, viewport, sizeof(viewport));
+        pose.swap(nextPose);
+
+        staticFrames = 0;
+        release();
+        return false;
+    }
+
+    if (staticFrames < STATIC_FRAMES)
+        staticFrames++;
+
+    return staticFrames >= STATIC_FRAMES;
+}
+
+/**
+ * Renders the textured faces of the layer into the image, at the window
+ * rectangle they cover. Nothing is rendered if the image would be larger
+ * than \a maxArea pixels, the layer has to be drawn face by face then.
+ * \param mesh      mesh of the layer
+ * \param points    x and y view coordinates of every vertex, see
+ *                  Mesh::projectVertices()
+ * \param buffer    buffer to draw the faces from
+ * \param maxArea   number of pixels the image can have
+ * \retval bool true if the image is rendered
+ **/
+bool LayerCache::render(Mesh *mesh, const float *points, MeshBuffer *buffer,
+                        unsigned maxArea)
+{
+    /* bounding rectangle of the vertices in whole pixels, clipped to the
+     * viewport */
+    unsigned count = mesh->getVertices()->size();
+    float min[2] = { viewport[0] + viewport[2], viewport[1] + viewport[3] };
+    float max[2] = { viewport[0], viewport[1] };
+    for (unsigned i = 0; i < count * 2; i++) {
+        float p = points[i];
+        if (p < min[i & 1])
+            min[i & 1] = p;
+        if (p > max[i & 1])
+            max[i & 1] = p;
+    }
+    for (int i = 0; i < 2; i++) {
+        if (min[i] < viewport[i])
+            min[i] = viewport[i];
+        if (max[i] > viewport[i] + viewport[i + 2])
+            max[i] = viewport[i] + viewport[i + 2];
+        rect[i] = (int)floorf(min[i]);
+        rect[i + 2] = (int)ceilf(max[i]) - rect[i];
+    }
+
+    if ((rect[2] <= 0) || (rect[3] <= 0)) {
+        /* nothing to draw */
+        release();
+        rendered = true;
+        return true;
+    }
+
+    if ((unsigned)(rect[2] * rect[3]) > maxArea)
+        return false;
+
+    glPushAttrib(GL_COLOR_BUFFER_BIT | GL_ENABLE_BIT | GL_VIEWPORT_BIT |
+                 GL_CURRENT_BIT | GL_TEXTURE_BIT);
+
+    /* the windows draw into the default framebuffer, which is bound again
+     * afterwards instead of reading back the binding */
+    if (!allocate(rect[2], rect[3])) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glPopAttrib();
+        return false;
+    }
+
+    glViewport(0, 0, width, height);
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(rect[0], rect[0] + rect[2], rect[1], rect[1] + rect[3], 0, 1);
+
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    glClearColor(0, 0, 0, 0);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    /* the colors are multiplied by their alpha, the alpha of the faces is
+     * accumulated as the window would be covered by them */
+    glEnable(GL_BLEND);
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA,
+                        GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glColor4f(1.f, 1.f, 1.f, alpha);
+
+    buffer->clear();
+    buffer->add(mesh->getVertices(), mesh->getFaces(), revision, region,
+                points);
+    buffer->draw();
+
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+
+    glMatrixMode(GL_MODELVIEW);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glPopAttrib();
+
+    rendered = true;
+    return true;
+}
+
+/**
+ * Draws the image in window coordinates. \c GL_TEXTURE_2D has to be
+ * enabled.
+ **/
+void LayerCache::draw(void)
+{
+    if (image == 0)
+        return;
+
+    glBindTexture(GL_TEXTURE_2D, image);
+
+    /* the image is premultiplied by its alpha */
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glColor4f(1.f, 1.f, 1.f, 1.f);
+
+    float x0 = rect[0];
+    float y0 = rect[1];
+    float x1 = rect[0] + rect[2];
+    float y1 = rect[1] + rect[3];
+
+    glBegin(GL_QUADS);
+    glTexCoord2f(0, 0);
+    glVertex2f(x0, y0);
+    glTexCoord2f(1, 0);
+    glVertex2f(x1, y0);
+    glTexCoord2f(1, 1);
+    glVertex2f(x1, y1);
+    glTexCoord2f(0, 1);
+    glVertex2f(x0, y1);
+    glEnd();
+
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+/**
+ * Creates the image texture and its framebuffer if they don't exist with
+ * the given size, and binds the framebuffer.
+ * \param w     width of the image
+ * \param h     height of the image
+ * \retval bool false if the framebuffer can't be drawn to
+ **/
+bool LayerCache::allocate(unsigned w, unsigned h)
+{
+    if (image && ((width != w) || (height != h)))
+        release();
+
+    if (image == 0) {
+        glGenTextures(1, &image);
+        glBindTexture(GL_TEXTURE_2D, image);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        /* the image is drawn pixel to pixel */
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA,
+                     GL_UNSIGNED_BYTE, NULL);
+        width = w;
+        height = h;
+
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                               GL_TEXTURE_2D, image, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) !=
+            GL_FRAMEBUFFER_COMPLETE) {
+            release();
+            return false;
+        }
+    }
+    else {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    }
+
+    return true;
+}
+
+/**
+ * Deletes the image texture and its framebuffer, the layer has to be
+ * rendered again.
+ **/
+void LayerCache::release(void)
+{
+    if (framebuffer) {
+        glDeleteFramebuffers(1, &framebuffer);
+        framebuffer = 0;
+    }
+    if (image) {
+        glDeleteTextures(1, &image);
+        image = 0;
+    }
+
+    width = 0;
+    height = 0;
+    rendered = false;
+}
@@ -0,0 +1,113 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#ifndef __LAYERCACHE_H__
+#define __LAYERCACHE_H__
+
+#if defined(__APPLE__)
+#include <OPENGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <vector>
+
+#include "Mesh.h"
+#include "MeshBuffer.h"
+
+using namespace std;
+
+namespace Animata
+{
+
+/// Image of the textured faces of a static layer.
+/**
+ * The textured faces of a layer which has not changed for STATIC_FRAMES
+ * frames are rendered once into an offscreen texture, in the window
+ * coordinates they are drawn at, and the texture is drawn as a single quad
+ * in the following frames. The layer is compared to the last frame every
+ * time by everything its textured faces are drawn from: the latched vertex
+ * positions, the texture coordinates, the faces, the texture, the alpha and
+ * the projection of the layer. Anything changed drops the image, so the
+ * cache never shows a layer differently than drawing its faces would.
+ *
+ * The image is rendered with premultiplied alpha, so overlapping faces are
+ * blended the same way as in the window. Framebuffer objects are needed,
+ * the layers are drawn face by face if isAvailable() returns false.
+ **/
+class LayerCache
+{
+public:
+    /// minimum number of faces of a layer to be cached
+    static const unsigned MIN_FACES = 32;
+    /// frames a layer has to be unchanged for before it is cached
+    static const int STATIC_FRAMES = 4;
+
+    LayerCache();
+    ~LayerCache();
+
+    static bool isAvailable(void);
+
+    bool update(Mesh *mesh, GLuint texture, const float *region);
+    bool render(Mesh *mesh, const float *points, MeshBuffer *buffer,
+                unsigned maxArea);
+    void draw(void);
+
+    /**
+     * Checks whether the image is rendered and can be drawn.
+     * \retval bool true if render() has to be called before draw()
+     */
+    inline bool isRendered(void) const { return rendered; }
+
+    /**
+     * Returns the number of pixels allocated for the image.
+     * \retval unsigned Width multiplied by the height of the image.
+     */
+    inline unsigned getArea(void) const { return width * height; }
+
+private:
+    vector<float> pose;     ///< positions and texture coordinates drawn
+    vector<float> nextPose; ///< the ones of the current frame
+    unsigned revision;      ///< revision of the mesh
+    GLuint texture;         ///< OpenGL texture of the mesh
+    float region[4];        ///< offset and size of the texture on it
+    float alpha;            ///< alpha of the texture
+    float view[16];         ///< view matrix of the layer
+    float viewport[4];      ///< viewport the layer is projected to
+
+    int staticFrames;       ///< number of frames the layer was unchanged
+    bool rendered;          ///< set if the image shows the layer
+
+    int rect[4];            ///< window rectangle of the image
+    unsigned width;         ///< width of the image texture
+    unsigned height;        ///< height of the image texture
+    GLuint image;           ///< image texture, 0 if not created
+    GLuint framebuffer;     ///< framebuffer of the image, 0 if not created
+
+    bool allocate(unsigned w, unsigned h);
+    void release(void);
+};
+
+} /* namespace Animata */
+
+#endif
+
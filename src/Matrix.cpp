@@ -25,6 +25,10 @@
 #include <stdio.h>
 #include <math.h>
 
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
 using namespace Animata;
 
 Matrix::Matrix()
@@ -38,6 +42,38 @@ Matrix::Matrix(double e[16])
         f[i] = e[i];
 }
 
+/**
+ * Constructs the transformation that translates with -origin, scales, rotates
+ * and finally translates to the given position. The result is the same as
+ * calling translate(), scale(), rotate() and translate() on an identity
+ * matrix, but the elements are calculated directly without the intermediate
+ * multiplications.
+ * \param origin the point to scale and rotate around
+ * \param s scale along the axes
+ * \param a rotation angles
+ * \param position translation applied after the rotation
+ **/
+Matrix::Matrix(const Vector3D& origin, const Vector3D& s, const Angle3D& a,
+               const Vector3D& position)
+{
+    float r[9];
+    rotation(a, r);
+
+    float sv[3] = { s.x, s.y, s.z };
+    float ov[3] = { -origin.x * s.x, -origin.y * s.y, -origin.z * s.z };
+    float pv[3] = { position.x, position.y, position.z };
+
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++)
+            f[i*4 + j] = sv[i] * r[i*3 + j];
+        f[i*4 + 3] = 0.f;
+    }
+
+    for (int j = 0; j < 3; j++)
+        f[12 + j] = ov[0] * r[j] + ov[1] * r[3 + j] + ov[2] * r[6 + j] + pv[j];
+    f[15] = 1.f;
+}
+
 /**
  * sets to zero every item of the matrix
  **/
@@ -58,31 +94,28 @@ void Matrix::loadIdentity()
 }
 
 /**
- * Computes the inverse rotation portion of this matrix and returns it as a new
- * object.  In case of OpenGL, the inverse of the rotation is the transpose of
- * the rotation.
+ * Computes the inverse rotation portion of this matrix. In case of OpenGL, the
+ * inverse of the rotation is the transpose of the rotation.
  **/
-Matrix& Matrix::inverseRotation()
+Matrix Matrix::inverseRotation() const
 {
-    Matrix *invrot = new Matrix();
-    invrot = this;
+    Matrix invrot(*this);
 
-    invrot->f[1] = f[4];
-    invrot->f[4] = f[1];
-    invrot->f[2] = f[8];
-    invrot->f[8] = f[2];
-    invrot->f[6] = f[9];
-    invrot->f[9] = f[6];
+    invrot.f[1] = f[4];
+    invrot.f[4] = f[1];
+    invrot.f[2] = f[8];
+    invrot.f[8] = f[2];
+    invrot.f[6] = f[9];
+    invrot.f[9] = f[6];
 
-    return *invrot;
+    return invrot;
 }
 
 /**
- * Compute the inverse only from the first three rows of this matrix and return
- * as a new object.
- * If the matrix is not invertible, null is returned.
+ * Compute the inverse only from the first three rows of this matrix.
+ * The matrix is not checked to be invertible.
  **/
-Matrix& Matrix::inverse()
+Matrix Matrix::inverse() const
 {
 
     float A0 = f[0] * f[5] - f[4] * f[1];
@@ -90,30 +123,28 @@ Matrix& Matrix::inverse()
     float A3 = f[4] * f[9] - f[8] * f[5];
     float det = A0 * f[10] - A1 * f[6] + A3 * f[2];
 
-//    if (fabs(det) < 1e-12f)
-//        return NULL; // matrix is not invertible
-
     float invDet = 1 / det;
     float A2 = f[0] * f[13] - f[12] * f[1];
     float A4 = f[4] * f[13] - f[12] * f[5];
     float A5 = f[8] * f[13] - f[12] * f[9];
 
-    Matrix *inv = new Matrix();
-
-    inv->f[0] = (+f[5] * f[10] - f[9] * f[6]) * invDet;
-    inv->f[1] = (-f[1] * f[10] + f[9] * f[2]) * invDet;
-    inv->f[2] = (+f[1] * f[6] - f[5] * f[2]) * invDet;
-    inv->f[4] = (-f[4] * f[10] + f[8] * f[6]) * invDet;
-    inv->f[5] = (+f[0] * f[10] - f[8] * f[2]) * invDet;
-    inv->f[6] = (-f[0] * f[6] + f[4] * f[2]) * invDet;
-    inv->f[8] = +A3 * invDet;
-    inv->f[9] = -A1 * invDet;
-    inv->f[10] = +A0 * invDet;
-    inv->f[12] = (-f[6] * A5 + f[10] * A4 - f[14] * A3) * invDet;
-    inv->f[13] = (+f[2] * A5 - f[10] * A2 + f[14] * A1) * invDet;
-    inv->f[14] = (-f[2] * A4 + f[6] * A2 - f[14] * A0) * invDet;
-
-    return *inv;
+    Matrix inv;
+
+    inv.f[0] = (+f[5] * f[10] - f[9] * f[6]) * invDet;
+    inv.f[1] = (-f[1] * f[10] + f[9] * f[2]) * invDet;
+    inv.f[2] = (+f[1] * f[6] - f[5] * f[2]) * invDet;
+    inv.f[4] = (-f[4] * f[10] + f[8] * f[6]) * invDet;
+    inv.f[5] = (+f[0] * f[10] - f[8] * f[2]) * invDet;
+    inv.f[6] = (-f[0] * f[6] + f[4] * f[2]) * invDet;
+    inv.f[8] = +A3 * invDet;
+    inv.f[9] = -A1 * invDet;
+    inv.f[10] = +A0 * invDet;
+    inv.f[12] = (-f[6] * A5 + f[10] * A4 - f[14] * A3) * invDet;
+    inv.f[13] = (+f[2] * A5 - f[10] * A2 + f[14] * A1) * invDet;
+    inv.f[14] = (-f[2] * A4 + f[6] * A2 - f[14] * A0) * invDet;
+    inv.f[15] = 1.f;
+
+    return inv;
 }
 
 Matrix& Matrix::operator = (const Matrix& m)
@@ -135,114 +166,153 @@ Matrix& Matrix::operator = (float e[16])
 /**
  * right multiply operator
  * the current matrix gets multiplied with the given one from right
- * /param m the given matrix to which the current is multiplied
+ * Each row of the result depends only on the same row of the current matrix,
+ * so the rows are overwritten in place.
+ * \param m the given matrix to which the current is multiplied
  **/
 Matrix& Matrix::operator *= (const Matrix& m)
 {
-    Matrix *temp = new Matrix();
-    *temp = *this;
-
-    this->clear();
+#if defined(__SSE__)
+    __m128 r0 = _mm_loadu_ps(m.f);
+    __m128 r1 = _mm_loadu_ps(m.f + 4);
+    __m128 r2 = _mm_loadu_ps(m.f + 8);
+    __m128 r3 = _mm_loadu_ps(m.f + 12);
+
+    for (int i = 0; i < 16; i += 4) {
+        __m128 row = _mm_mul_ps(_mm_set1_ps(f[i]), r0);
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(f[i + 1]), r1));
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(f[i + 2]), r2));
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(f[i + 3]), r3));
+        _mm_storeu_ps(f + i, row);
+    }
+#else
+    float r[16];
+    for (int i = 0; i < 16; i++)
+        r[i] = m[i];
 
-    for (int i = 0; i < 4; i++)
+    for (int i = 0; i < 16; i += 4) {
+        float row[4];
         for (int j = 0; j < 4; j++)
-            for (int k = 0; k < 4; k++)
-                f[i*4 + j] += (*temp)[i*4 + k] * m[k*4 + j];
+            row[j] = f[i] * r[j] + f[i + 1] * r[4 + j] +
+                     f[i + 2] * r[8 + j] + f[i + 3] * r[12 + j];
+        for (int j = 0; j < 4; j++)
+            f[i + j] = row[j];
+    }
+#endif
 
-    delete temp;
     return *this;
 }
 
 /**
- * constructs a translate matrix from the given translation vector
- * and multiplies it to the current matrix
- * /param v vector specifying the translation
+ * right multiplication
+ * \param m the matrix multiplied from right
+ * \return the product of this matrix and m
  **/
-Matrix& Matrix::translate(const Vector3D& v)
+Matrix Matrix::operator * (const Matrix& m) const
 {
-    Matrix t;
-    t.loadIdentity();
+    Matrix r(*this);
+    r *= m;
+    return r;
+}
 
-    t[12] = v.x;
-    t[13] = v.y;
-    t[14] = v.z;
+/**
+ * multiplies the current matrix with a translate matrix specified by the
+ * given translation vector
+ * As the translate matrix only differs from the identity in its last row, it
+ * is enough to add the translation scaled by the last column to each row.
+ * \param v vector specifying the translation
+ **/
+Matrix& Matrix::translate(const Vector3D& v)
+{
+    for (int i = 0; i < 16; i += 4) {
+        float w = f[i + 3];
+        f[i] += w * v.x;
+        f[i + 1] += w * v.y;
+        f[i + 2] += w * v.z;
+    }
 
-    // left or right?
-    *this *= t;
     return *this;
 }
 
 /**
- * constructs a scale matrix from the given scale vector
- * and multiplies it to the current matrix
- * /param v vector specifying the scale
+ * multiplies the current matrix with a scale matrix specified by the given
+ * scale vector, which scales the first three columns
+ * \param v vector specifying the scale
  **/
 Matrix& Matrix::scale(const Vector3D& v)
 {
-    Matrix t;
-    t.loadIdentity();
-
-    t[0] = v.x;
-    t[5] = v.y;
-    t[10] = v.z;
+    for (int i = 0; i < 16; i += 4) {
+        f[i] *= v.x;
+        f[i + 1] *= v.y;
+        f[i + 2] *= v.z;
+    }
 
-    // left or right?
-    *this *= t;
     return *this;
 }
 
 /**
- * constructs a rotation matrix from the given angle
- * and multiplies it to the current matrix
- * /param theta angle to rotate around the z-axis
+ * calculates the 3x3 rotation matrix of the given angles
+ * \param a rotation angles around the x, y and z axes
+ * \param r array of 9 floats receiving the rotation row by row
+ **/
+void Matrix::rotation(const Angle3D& a, float r[9])
+{
+    float sinA = sin(a.x);
+    float cosA = cos(a.x);
+    float sinB = sin(a.y);
+    float cosB = cos(a.y);
+    float sinC = sin(a.z);
+    float cosC = cos(a.z);
+
+    r[0] = cosB * cosC;
+    r[1] = -cosB * sinC;
+    r[2] = sinB;
+    r[3] = cosA * sinC + sinA * sinB * cosC;
+    r[4] = cosA * cosC - sinA * sinB * sinC;
+    r[5] = -sinA * cosB;
+    r[6] = sinA * sinC - cosA * sinB * cosC;
+    r[7] = sinA * cosC + cosA * sinB * sinC;
+    r[8] = cosA * cosB;
+}
+
+/**
+ * multiplies the current matrix with the rotation matrix of the given angle
+ * Only the first three columns are affected.
+ * \param angle rotation angles around the x, y and z axes
  **/
 Matrix& Matrix::rotate(const Angle3D& angle)
 {
-    Matrix t;
-    t.loadIdentity();
-
-    float sinA = sin(angle.x);
-    float cosA = cos(angle.x);
-    float sinB = sin(angle.y);
-    float cosB = cos(angle.y);
-    float sinC = sin(angle.z);
-    float cosC = cos(angle.z);
-
-    t[0] = cosB * cosC;;
-    t[1] = -cosB * sinC;
-    t[2] = sinB;
-    t[4] = cosA * sinC + sinA * sinB * cosC;
-    t[5] = cosA * cosC - sinA * sinB * sinC;
-    t[6] = -sinA * cosB;
-    t[8] = sinA * sinC - cosA * sinB * cosC;
-    t[9] = sinA * cosC + cosA * sinB * sinC;
-    t[10] = cosA * cosB;
-
-    // left or right?
-    *this *= t;
+    float r[9];
+    rotation(angle, r);
+
+    for (int i = 0; i < 16; i += 4) {
+        float x = f[i];
+        float y = f[i + 1];
+        float z = f[i + 2];
+        f[i] = x * r[0] + y * r[3] + z * r[6];
+        f[i + 1] = x * r[1] + y * r[4] + z * r[7];
+        f[i + 2] = x * r[2] + y * r[5] + z * r[8];
+    }
+
     return *this;
 }
 
 /**
- * constructs a rotation matrix from the given angle
- * and multiplies it to the current matrix
- * /param theta angle to rotate around the z-axis
+ * multiplies the current matrix with the rotation matrix of the given angle
+ * \param theta angle to rotate around the z-axis
  **/
 Matrix& Matrix::rotateZ(float theta)
 {
-    Matrix t;
-    t.loadIdentity();
-
     float sinTheta = sin(theta);
     float cosTheta = cos(theta);
 
-    t[0] = cosTheta;
-    t[1] = -sinTheta;
-    t[4] = sinTheta;
-    t[5] = cosTheta;
+    for (int i = 0; i < 16; i += 4) {
+        float x = f[i];
+        float y = f[i + 1];
+        f[i] = x * cosTheta + y * sinTheta;
+        f[i + 1] = -x * sinTheta + y * cosTheta;
+    }
 
-    // left or right?
-    *this *= t;
     return *this;
 }
 
@@ -256,4 +326,3 @@ void Matrix::print()
     }
     printf("\n");
 }
-
@@ -40,6 +40,8 @@ public:
 
     Matrix();
     Matrix(double e[16]);
+    Matrix(const Vector3D& origin, const Vector3D& s, const Angle3D& a,
+           const Vector3D& position);
 
     void clear();           ///< zero matrix
     void loadIdentity();    ///< indentity matrix
@@ -50,12 +52,13 @@ public:
     Matrix& operator = (const Matrix& m);     ///< assignment operator
     Matrix& operator = (float e[16]);   ///< float assignment operator
     Matrix& operator *= (const Matrix& m);    ///< right multiply operator
+    Matrix operator * (const Matrix& m) const;  ///< right multiplication
 
     ///< computes the inverse rotation from the 3x3 rotation portion of this matrix
-    Matrix& inverseRotation();
+    Matrix inverseRotation() const;
 
     ///< computes and returns the inverse of this matrix
-    Matrix& inverse();
+    Matrix inverse() const;
 
     ///< mutiplies the current matrix with the given translate matrix
     Matrix& translate(const Vector3D& v);
@@ -68,6 +71,10 @@ public:
     Matrix& rotateZ(float theta);
 
     void print();
+
+private:
+
+    static void rotation(const Angle3D& a, float r[9]);
 };
 
 } /* namespace Animata */
@@ -24,19 +24,26 @@
 #include <stdio.h>
 #include <iostream>
 #include <algorithm>
+#include <map>
 
+#include "Context.h"
+#include "Mesh.h"
+#include "Subdiv.h"
+
+#ifndef ANIMATA_HEADLESS
 #include "animata.h"
 #include "animataUI.h"
 #include "Primitives.h"
-#include "Mesh.h"
-#include "Subdiv.h"
 #include "Transform.h"
+#include "Skeleton.h"
+#include "SkinShader.h"
 
 #if defined(__APPLE__)
     #include <OPENGL/gl.h>
 #else
     #include <GL/gl.h>
 #endif
+#endif
 
 using namespace Animata;
 
@@ -53,6 +60,13 @@ Mesh::Mesh()
     pFace = NULL;
 
     textureAlpha = 1.0f;
+    skeleton = NULL;
+
+    revision = 0;
+#ifndef ANIMATA_HEADLESS
+    buffer = new MeshBuffer();
+    viewRevision = 0;
+#endif
 }
 
 /**
@@ -72,6 +86,10 @@ Mesh::~Mesh()
         clearFaces();
         delete faces;
     }
+
+#ifndef ANIMATA_HEADLESS
+    delete buffer;
+#endif
 }
 
 /**
@@ -83,6 +101,7 @@ Vertex *Mesh::addVertex(const Vector2D& pos)
 {
     Vertex *v = new Vertex(pos);
     vertices->push_back(v);
+    revision++;
     return v;
 }
 
@@ -116,6 +135,7 @@ void Mesh::addFace(Vertex *v0, Vertex *v1, Vertex *v2)
     }
 
     faces->push_back(new Face(v0, v1, v2));
+    revision++;
 
     /* if there's a texture attached add texture coordinates also */
     if (attachedTexture) {
@@ -134,6 +154,7 @@ void Mesh::clearFaces(void)
     for (; f < faces->end(); f++)
         delete *f;  // free faces from memory
     faces->clear(); // clear all vector elements
+    revision++;
 }
 
 /**
@@ -150,6 +171,7 @@ int Mesh::getSelectedVerticesCount(void)
     return s;
 }
 
+#ifndef ANIMATA_HEADLESS
 /**
  * Turns selected to true on the i.th vertex.
  * \param i     The number of the vertex to select.
@@ -187,6 +209,7 @@ void Mesh::circleSelect(unsigned i, int type, const Vector2D& center,
             break;
     }
 }
+#endif
 
 void Mesh::triangulateSelected(void)
 {
@@ -218,6 +241,7 @@ void Mesh::triangulateSelected(void)
                 vector<Face *>::iterator faceIter = faces->begin() + i;
                 delete face;
                 faces->erase(faceIter);
+                revision++;
             }
         }
     }
@@ -306,7 +330,7 @@ void Mesh::triangulateFaceProc(int p0, int p1, int p2)
         Vector2D t2 = (v2->coord - t->position) * scaleInv;
 
         int alpha = attachedTexture->getTriangleAlpha(t0, t1, t2, 4);
-        if (alpha < ui->settings.triangulateAlphaThreshold)
+        if (alpha < context->getSettings()->triangulateAlphaThreshold)
             return;
     }
 
@@ -340,7 +364,7 @@ void Mesh::triangulateFaceProcSelected(int p0, int p1, int p2)
         Vector2D t2 = (v2->coord - t->position) * scaleInv;
 
         int alpha = attachedTexture->getTriangleAlpha(t0, t1, t2, 4);
-        if (alpha < ui->settings.triangulateAlphaThreshold)
+        if (alpha < context->getSettings()->triangulateAlphaThreshold)
             return;
     }
     addFace(v0, v1, v2);
@@ -362,13 +386,16 @@ static bool triangleSortPredicate(Face *a, Face *b)
 void Mesh::sortFaces(void)
 {
     sort(faces->begin(), faces->end(), triangleSortPredicate);
+    revision++;
 }
 
 void Mesh::sortFaces(vector<Face *>::iterator begin, vector<Face *>::iterator end)
 {
     sort(begin, end, triangleSortPredicate);
+    revision++;
 }
 
+#ifndef ANIMATA_HEADLESS
 /**
  * Finds the selected vertex.
  * \param ppv Pointer to the vertex pointer.
@@ -424,6 +451,7 @@ void Mesh::deleteSelectedVertex(void)
 
     delete *iter;               // delete object
     vertices->erase(iter);      // remove it from the vector
+    revision++;
 
     // current selection points to the next joint after the deleted one
     selector->clearSelection();
@@ -442,12 +470,14 @@ void Mesh::deleteSelectedFace(Face *f)
             vector<Face *>::iterator faceIter = faces->begin() + i;
             delete face;
             faces->erase(faceIter);
+            revision++;
             break;
         }
     }
     /* clear selection, because it contains a non-existing object */
     selector->clearSelection();
 }
+#endif
 
 /**
  * Attaches a texture to the mesh.
@@ -461,6 +491,9 @@ void Mesh::attachTexture(Texture *t)
     for (unsigned int i = 0; i < faces->size(); i++) {
         (*faces)[i]->attachTexture(attachedTexture);
     }
+
+    /* the texture coordinates are not published with the pose */
+    context->invalidateFrame();
 }
 
 /**
@@ -504,36 +537,130 @@ vector<Vertex *> *Mesh::getSelectedVertices()
     return selectedVertices;
 }
 
+#ifndef ANIMATA_HEADLESS
 /**
- * Sets the view coordinates of the vertices of this mesh.
- * Setting the transformation matrices by Transform::setMatrices() is neccesary
- * before calling this, because Transform::project() is used for non visible
- * primitives. If any coordinate's value is Selection::OUT_OF_SCREEN,
- * Transform::project() tries to calculate the vertex's screen coordinate.
- * \param coords    An array which holds the screen coordinates of the vertices.
- *                  Three elements in a row will represent a vertex's screen
- *                  coordinate. First one is the vertex's number, second and
- *                  third is the \e x and \e y screen coordinate.
- * \param size      Size of the \c coords array.
+ * Projects the drawn positions of the vertices of this mesh to the screen
+ * with Transform::projectPoints(). Setting the transformation matrices by
+ * Transform::setMatrices() is neccesary before calling this.
+ * \param coords    Array of at least two elements per vertex, receiving the
+ *                  x and y view coordinates.
  **/
-void Mesh::setVertexViewCoords(float *coords, unsigned int size)
+void Mesh::projectVertices(float *coords)
 {
-    for (unsigned i = 0; i < size; i+=3) {
-        unsigned n = (unsigned)coords[i];
-        Vertex *v = (*vertices)[n];
+    unsigned count = vertices->size();
+    for (unsigned i = 0; i < count; i++) {
+        const Vector2D& coord = getPoseCoord(i);
+        coords[i * 2] = coord.x;
+        coords[i * 2 + 1] = coord.y;
+    }
 
-        // vertex is out of screen lets do projection here
-        if (i + 1 < size && coords[i + 1] == Selection::OUT_OF_SCREEN) {
-            Vector3D view = Transform::project(v->coord);
+    Transform::projectPoints(coords, count);
+}
 
-            v->view.x = view.x;
-            v->view.y = view.y;
-        }
-        else {
-            v->view.x = coords[i + 1];
-            v->view.y = coords[i + 2];
+/**
+ * Gets the drawn positions and the texture coordinates of the vertices,
+ * which the textured faces are drawn from besides the faces and the
+ * texture.
+ * \param data    Receives the x, y position and the u, v texture coordinates
+ *                of every vertex.
+ **/
+void Mesh::getTexturedPose(vector<float> *data)
+{
+    unsigned count = vertices->size();
+    data->resize(count * 4);
+    for (unsigned i = 0; i < count; i++) {
+        const Vector2D& coord = getPoseCoord(i);
+        const Vector2D& texCoord = (*vertices)[i]->texCoord;
+        (*data)[i * 4] = coord.x;
+        (*data)[i * 4 + 1] = coord.y;
+        (*data)[i * 4 + 2] = texCoord.x;
+        (*data)[i * 4 + 3] = texCoord.y;
+    }
+}
+
+/**
+ * Sets the view coordinates of the vertices of this mesh, which are used for
+ * editing the mesh and drawing its wireframe.
+ * \param coords    x and y view coordinates of every vertex as computed by
+ *                  projectVertices()
+ **/
+void Mesh::setVertexViewCoords(const float *coords)
+{
+    bool changed = false;
+    unsigned count = vertices->size();
+    for (unsigned i = 0; i < count; i++) {
+        Vertex *v = (*vertices)[i];
+        if ((v->view.x != coords[i * 2]) || (v->view.y != coords[i * 2 + 1])) {
+            v->view.x = coords[i * 2];
+            v->view.y = coords[i * 2 + 1];
+            changed = true;
         }
     }
+
+    if (changed)
+        viewRevision++;
+}
+#endif
+
+/**
+ * Copies the vertex positions to the pose buffer and publishes them for
+ * drawing. Called by the simulation thread.
+ * \retval bool True if the positions have changed since the last time.
+ */
+bool Mesh::publishPose(void)
+{
+    vector<Vector2D> *p = pose.getBack();
+    unsigned count = vertices->size();
+
+    p->resize(count);
+    for (unsigned i = 0; i < count; i++)
+        (*p)[i] = (*vertices)[i]->coord;
+
+    return pose.publish(revision);
+}
+
+/**
+ * Returns the position of a vertex in the latched pose. If vertices were
+ * added, removed or reordered since the pose was published, the vertices
+ * are at their current position until the next pose is latched.
+ * \param    i    Index of the vertex.
+ * \retval const Vector2D& The position of the vertex.
+ */
+const Vector2D& Mesh::getPoseCoord(unsigned i)
+{
+    const vector<Vector2D> *p = pose.getFront();
+    if ((pose.getFrontRevision() == revision) && (i < p->size()))
+        return (*p)[i];
+    else
+        return (*vertices)[i]->coord;
+}
+
+/**
+ * Gets the bounding box of the vertices in the latched pose.
+ * \param min   Receives the lower corner of the box.
+ * \param max   Receives the upper corner of the box.
+ * \retval bool False if the mesh has no vertices.
+ */
+bool Mesh::getPoseBounds(Vector2D *min, Vector2D *max)
+{
+    unsigned count = vertices->size();
+    if (count == 0)
+        return false;
+
+    *min = *max = getPoseCoord(0);
+    for (unsigned i = 1; i < count; i++) {
+        const Vector2D& p = getPoseCoord(i);
+        if (p.x < min->x)
+            min->x = p.x;
+        else if (p.x > max->x)
+            max->x = p.x;
+        if (p.y < min->y)
+            min->y = p.y;
+        else if (p.y > max->y)
+            max->y = p.y;
+    }
+
+    return true;
 }
 
 /**
@@ -546,20 +673,90 @@ void Mesh::clearSelection(void)
     }
 }
 
+#ifndef ANIMATA_HEADLESS
 /**
- * Draws the mesh.
- * Vertices, faces and faces with textures attached to the mesh get drawn
- * based on the actual AnimataSettings::display_elements.
+ * Checks whether the textured faces are drawn in the given mode.
+ * \param mode  drawing mode as in draw()
+ * \retval bool true if there is a texture attached and textures are
+ *              displayed in the window drawn
+ */
+bool Mesh::isTextureShown(int mode)
+{
+    int display = ui->settings.display_elements;
+
+    return attachedTexture && (mode & RENDER_TEXTURE) &&
+        ((!(mode & RENDER_OUTPUT) && (display & DISPLAY_EDITOR_TEXTURE)) ||
+         ((mode & RENDER_OUTPUT) && (display & DISPLAY_OUTPUT_TEXTURE)));
+}
+
+/**
+ * Decides whether the textured faces are skinned in SkinShader when drawn.
+ * The vertices are skinned in the shader if their positions are not needed
+ * for drawing or editing the mesh, the skinning of the skeleton is deferred
+ * meanwhile.
+ * \retval bool true if the textured faces have to be drawn by drawSkinned()
+ */
+bool Mesh::updateSkinning(void)
+{
+    AnimataSettings *settings = &ui->settings;
+    bool gpuSkinning = skeleton && !skeleton->getBones()->empty() &&
+                       (skeleton->getBones()->size() <=
+                        (unsigned)SkinShader::MAX_BONES) &&
+                       SkinShader::isAvailable();
+    bool skinOnGPU = gpuSkinning && settings->gpuSkinning &&
+        !isMeshMode(settings->mode) &&
+        (settings->mode != ANIMATA_MODE_ATTACH_VERTICES) &&
+        !(settings->display_elements &
+          (DISPLAY_EDITOR_VERTEX | DISPLAY_EDITOR_TRIANGLE |
+           DISPLAY_OUTPUT_VERTEX | DISPLAY_OUTPUT_TRIANGLE));
+    if (skeleton)
+        skeleton->deferSkinning(skinOnGPU);
+
+    /* keep drawing the skinned pose until the vertices caught up */
+    return skinOnGPU || (gpuSkinning && skeleton->isSkinStale());
+}
+
+/**
+ * Draws the textured faces skinned by the skeleton in SkinShader.
+ * \c GL_TEXTURE_2D has to be enabled.
+ * \param view      projection and modelview matrix of the layer, see
+ *                  Transform::getViewMatrix()
+ * \param viewport  viewport the layer is projected to
+ * \sa updateSkinning()
+ */
+void Mesh::drawSkinned(const float *view, const float *viewport)
+{
+    GLuint texture;
+    float region[4];
+    MeshBuffer::selectTexture(vertices, attachedTexture, &texture, region);
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glColor4f(1.f, 1.f, 1.f, textureAlpha);
+
+    /* the vertices are drawn at their current position while the latched
+     * pose is older than the mesh */
+    vector<Vector2D> current;
+    const vector<Vector2D> *coords = pose.getFront();
+    if (pose.getFrontRevision() != revision)
+        coords = &current;
+
+    buffer->drawSkinned(vertices, coords, faces, revision, region,
+                        skeleton, skeleton->getSkinPasses(), view,
+                        viewport);
+
+    glColor3f(1.f, 1.f, 1.f);
+}
+
+/**
+ * Draws the wireframe of the mesh.
+ * Vertices and faces get drawn based on the actual
+ * AnimataSettings::display_elements. The textured faces are drawn by
+ * DrawList.
  *
- * There are four drawing modes at this time, which can be combined by
+ * There are two drawing modes at this time, which can be combined by
  * bitwise or.
- *    - RENDER_FEEDBACK\n
- *        Only draws a point to every vertex of the mesh, to get their exact
- *        position that can be used to set their screen coordinates.
  *    - RENDER_WIREFRAME\n
  *        Draws vertex and face outlines.
- *    - RENDER_TEXTURE\n
- *        Draws textured faces if there is a texture attached to the mesh.
  *    - RENDER_OUTPUT\n
  *        Indicates that the drawing happens in the output window, there is no
  *        need for mouseOver for the primitives.
@@ -602,82 +799,69 @@ void Mesh::draw(int mode, int active)
         selected++;
     }
 
-    if (attachedTexture && (mode & RENDER_TEXTURE) &&
-        ((!(mode & RENDER_OUTPUT) && (ui->settings.display_elements & DISPLAY_EDITOR_TEXTURE)) ||
-        ((mode & RENDER_OUTPUT) && (ui->settings.display_elements & DISPLAY_OUTPUT_TEXTURE)))) {
-        glColor3f(1.f, 1.f, 1.f);
-        glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, attachedTexture->getGlResource());
-
-        for (unsigned int i = 0; i < faces->size(); i++) {
-            Face *face = (*faces)[i];
-
-            glColor4f(1.f, 1.f, 1.f, textureAlpha);
-            glBegin(GL_TRIANGLES);
-                glTexCoord2f(face->v[0]->texCoord.x, face->v[0]->texCoord.y);
-                glVertex2f(face->v[0]->view.x, face->v[0]->view.y);
-                glTexCoord2f(face->v[1]->texCoord.x, face->v[1]->texCoord.y);
-                glVertex2f(face->v[1]->view.x, face->v[1]->view.y);
-                glTexCoord2f(face->v[2]->texCoord.x, face->v[2]->texCoord.y);
-                glVertex2f(face->v[2]->view.x, face->v[2]->view.y);
-            glEnd();
-            glColor3f(1.f, 1.f, 1.f);
-        }
-
-        glDisable(GL_TEXTURE_2D);
-    }
-
     if ((mode & RENDER_WIREFRAME) &&
         ((!(mode & RENDER_OUTPUT) && (ui->settings.display_elements & DISPLAY_EDITOR_TRIANGLE)) ||
         ((mode & RENDER_OUTPUT) && (ui->settings.display_elements & DISPLAY_OUTPUT_TRIANGLE)))) {
-        glLoadName(Selection::SELECT_TRIANGLE);    // type of the primitive
-        glPushName(0);                            // id of the primitive
-
         for (unsigned int i = 0; i < faces->size(); i++) {
             Face *face = (*faces)[i];
 
-            glLoadName(i);
-
             if (mode & RENDER_OUTPUT)
                 Primitives::drawFace(face);
             else
                 Primitives::drawFace(face, face == pFace, active);
         }
-        glPopName();
     }
 
-    if (mode & RENDER_FEEDBACK) {
-        for (unsigned int i = 0; i < vertices->size(); i++) {
-            Vertex *vertex = (*vertices)[i];
-
-            glPassThrough(i);
-            glBegin(GL_POINTS);
-                glVertex2f(vertex->coord.x, vertex->coord.y);
-            glEnd();
-        }
-    }
-    else if ((mode & RENDER_WIREFRAME) &&
+    if ((mode & RENDER_WIREFRAME) &&
              ((!(mode & RENDER_OUTPUT)
                && (ui->settings.display_elements & DISPLAY_EDITOR_VERTEX)) ||
              ((mode & RENDER_OUTPUT)
               && ui->settings.display_elements & DISPLAY_OUTPUT_VERTEX))) {
-        glLoadName(Selection::SELECT_VERTEX);    // type of the primitive
-        glPushName(0);                            // id of the primitive
-
         for (unsigned int i = 0; i < vertices->size(); i++) {
             Vertex *vertex = (*vertices)[i];
 
-            glLoadName(i);
-
             if (mode & RENDER_OUTPUT)
                 vertex->draw(false);
             else
                 vertex->draw(vertex == pVertex, active);
         }
+    }
 
-        glPopName();
+}
+
+/**
+ * Draws the wireframe of the mesh in the output window from view coordinates
+ * kept outside the vertices, based on the actual
+ * AnimataSettings::display_elements.
+ * \param points    x and y view coordinates of every vertex
+ * \sa DrawList::drawWireframe()
+ */
+void Mesh::drawWireframe(const float *points)
+{
+    if (ui->settings.display_elements & DISPLAY_OUTPUT_TRIANGLE) {
+        map<Vertex *, unsigned> index;
+        for (unsigned i = 0; i < vertices->size(); i++)
+            index[(*vertices)[i]] = i * 2;
+
+        for (unsigned i = 0; i < faces->size(); i++) {
+            Face *face = (*faces)[i];
+            const float *p0 = points + index[face->v[0]];
+            const float *p1 = points + index[face->v[1]];
+            const float *p2 = points + index[face->v[2]];
+
+            Primitives::drawFace(Vector2D(p0[0], p0[1]),
+                                 Vector2D(p1[0], p1[1]),
+                                 Vector2D(p2[0], p2[1]));
+        }
     }
 
+    if (ui->settings.display_elements & DISPLAY_OUTPUT_VERTEX) {
+        for (unsigned i = 0; i < vertices->size(); i++) {
+            Vector2D p(points[i * 2], points[i * 2 + 1]);
+            Primitives::drawVertex((*vertices)[i], p, false, 1);
+        }
+    }
 }
+#endif
 
 
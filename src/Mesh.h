@@ -31,12 +31,19 @@
 #include "Joint.h"
 #include "Texture.h"
 #include "Drawable.h"
+#include "PoseBuffer.h"
+
+#ifndef ANIMATA_HEADLESS
+#include "MeshBuffer.h"
+#endif
 
 using namespace std;
 
 namespace Animata
 {
 
+class Skeleton;
+
 /// Represents an image which can be manipulated by a Skeleton.
 class Mesh : public Drawable
 {
@@ -54,8 +61,23 @@ private:
     Face *pFace;                ///< face below the mouse cursor
 
     float textureAlpha;         ///< texture alpha for drawing
+    Skeleton *skeleton;         ///< skeleton the vertices are attached to
     int *selectedPointIndices;  ///< helper array for triangulateSelected()
 
+    PoseBuffer pose;            ///< vertex positions published for drawing
+
+    /** incremented when faces or vertices are added, removed or reordered */
+    unsigned revision;
+
+#ifndef ANIMATA_HEADLESS
+    MeshBuffer *buffer;         ///< buffers the textured faces are drawn from
+
+    /** incremented when the view coordinates of the vertices change */
+    unsigned viewRevision;
+#endif
+
+    const Vector2D& getPoseCoord(unsigned i);
+
     int getSelectedVerticesCount(void);
     void triangulateSelected(void);
     void triangulateAll(void);
@@ -70,14 +92,30 @@ public:
 
     Vertex *addVertex(const Vector2D& pos);
 
+#ifndef ANIMATA_HEADLESS
     void deleteSelectedVertex(void);
     void deleteSelectedFace(Face *f);
+#endif
 
     int moveSelectedVertices(const Vector2D& d);
     void clearSelection(void);
     vector<Vertex *> *getSelectedVertices();
 
-    void setVertexViewCoords(float *coords, unsigned int size);
+    bool getPoseBounds(Vector2D *min, Vector2D *max);
+
+#ifndef ANIMATA_HEADLESS
+    void projectVertices(float *coords);
+    void getTexturedPose(vector<float> *data);
+    void setVertexViewCoords(const float *coords);
+#endif
+
+    bool publishPose(void);
+
+    /**
+     * Makes the latest published vertex positions the ones to be drawn.
+     * \retval bool True if the positions have changed.
+     */
+    inline bool latchPose(void) { return pose.latch(); }
 
     /**
      * Returns the vertex below the mouse cursor.
@@ -103,7 +141,9 @@ public:
      */
     inline vector<Face *> *getFaces(void) { return faces; }
 
+#ifndef ANIMATA_HEADLESS
     vector<Vertex *>::iterator getSelectedVertex(Vertex **ppv = NULL);
+#endif
 
     void addFace(Vertex *v0, Vertex *v1, Vertex *v2);
     void clearFaces(void);
@@ -135,10 +175,47 @@ public:
      */
     inline void setTextureAlpha(float alpha) { textureAlpha = alpha; }
 
+    /**
+     * Returns texture alpha for drawing.
+     * \retval float The texture alpha.
+     */
+    inline float getTextureAlpha(void) const { return textureAlpha; }
+
+    /**
+     * Returns the revision of the mesh, which changes when the faces or
+     * vertices are added, removed or reordered.
+     * \retval unsigned The revision.
+     */
+    inline unsigned getRevision(void) const { return revision; }
+
+#ifndef ANIMATA_HEADLESS
+    /**
+     * Returns the revision of the view coordinates of the vertices, which
+     * changes when they are set to different values.
+     * \retval unsigned The revision.
+     */
+    inline unsigned getViewRevision(void) const { return viewRevision; }
+#endif
+
+    /**
+     * Sets the skeleton the vertices are attached to, which can skin them
+     * when drawing.
+     * \param s The skeleton of the layer of the mesh.
+     */
+    inline void setSkeleton(Skeleton *s) { skeleton = s; }
+
+#ifndef ANIMATA_HEADLESS
+    bool isTextureShown(int mode);
+    bool updateSkinning(void);
+    void drawSkinned(const float *view, const float *viewport);
+
     virtual void draw(int mode, int active = 1);
+    void drawWireframe(const float *points);
+
     virtual void select(unsigned i, int type);
     virtual void circleSelect(unsigned i, int type, const Vector2D& center,
                               float radius);
+#endif
 };
 
 } /* namespace Animata */
@@ -0,0 +1,560 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* buffer object functions are part of OpenGL 1.5, vertex attributes of
+ * OpenGL 2.0 */
+#define GL_GLEXT_PROTOTYPES
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <map>
+
+#if defined(__APPLE__)
+#include <OPENGL/gl.h>
+#include <OPENGL/glext.h>
+#else
+#include <GL/gl.h>
+#include <GL/glext.h>
+#endif
+
+#include "MeshBuffer.h"
+#include "Skeleton.h"
+#include "SkinShader.h"
+
+using namespace Animata;
+
+/**
+ * Creates an empty buffer, the OpenGL buffer objects are created on the
+ * first draw.
+ **/
+MeshBuffer::MeshBuffer()
+{
+    partCount = 0;
+    vertexCount = 0;
+    indicesValid = false;
+
+    vertexBuffer = 0;
+    indexBuffer = 0;
+    vertexUpload = true;
+    indexUpload = true;
+
+    influenceRevision[0] = influenceRevision[1] = 0;
+    influencePasses = 0;
+    influencesValid = false;
+
+    influenceBuffer = 0;
+    influenceUpload = true;
+}
+
+/**
+ * Deletes the OpenGL buffer objects.
+ **/
+MeshBuffer::~MeshBuffer()
+{
+    if (vertexBuffer)
+        glDeleteBuffers(1, &vertexBuffer);
+    if (indexBuffer)
+        glDeleteBuffers(1, &indexBuffer);
+    if (influenceBuffer)
+        glDeleteBuffers(1, &influenceBuffer);
+}
+
+/**
+ * Checks once whether the OpenGL implementation supports buffer objects,
+ * either by being version 1.5 or later or by the ARB extension.
+ * \retval bool true if buffer objects can be used
+ **/
+bool MeshBuffer::hasBufferObjects(void)
+{
+    static int supported = -1;
+
+    if (supported < 0) {
+        const char *version = (const char *)glGetString(GL_VERSION);
+        const char *extensions = (const char *)glGetString(GL_EXTENSIONS);
+        int major = 0, minor = 0;
+
+        if (version == NULL)
+            return false;
+
+        sscanf(version, "%d.%d", &major, &minor);
+        supported = (major > 1) || ((major == 1) && (minor >= 5)) ||
+                    (extensions &&
+                     strstr(extensions, "GL_ARB_vertex_buffer_object"));
+    }
+
+    return supported;
+}
+
+/**
+ * Starts collecting the meshes to draw with the next draw() call.
+ **/
+void MeshBuffer::clear(void)
+{
+    partCount = 0;
+    vertexCount = 0;
+}
+
+/**
+ * Adds a mesh to be drawn with the next draw() call, with its view
+ * coordinates. The vertex data is only uploaded again if it changed, the
+ * indices only if other meshes or other revisions of them were added than
+ * the last time.
+ * \param vertices  vertices of the mesh
+ * \param faces     faces of the mesh
+ * \param revision  revision of the mesh, changes when the faces or vertices
+ *                  are added, removed or reordered
+ * \param region    offset and size of the texture of the mesh on the bound
+ *                  OpenGL texture, see selectTexture()
+ * \param points    x and y view coordinates of every vertex, see
+ *                  Mesh::projectVertices(), the view coordinates stored in
+ *                  the vertices are used if NULL
+ **/
+void MeshBuffer::add(vector<Vertex *> *vertices, vector<Face *> *faces,
+                     unsigned revision, const float *region,
+                     const float *points /* = NULL */)
+{
+    append(vertices, faces, revision, region, points, NULL);
+}
+
+/**
+ * Adds a mesh to the buffer.
+ * \sa add(), updateVertices()
+ **/
+void MeshBuffer::append(vector<Vertex *> *vertices, vector<Face *> *faces,
+                        unsigned revision, const float *region,
+                        const float *points, const vector<Vector2D> *coords)
+{
+    Part part;
+    part.vertices = vertices;
+    part.faces = faces;
+    part.revision = revision;
+    part.vertexCount = vertices->size();
+    part.faceCount = faces->size();
+
+    if (partCount == parts.size()) {
+        parts.push_back(part);
+        indicesValid = false;
+    }
+    else {
+        Part& p = parts[partCount];
+        if ((p.vertices != vertices) || (p.faces != faces) ||
+            (p.revision != revision) ||
+            (p.vertexCount != part.vertexCount) ||
+            (p.faceCount != part.faceCount)) {
+            p = part;
+            indicesValid = false;
+        }
+    }
+    partCount++;
+
+    updateVertices(vertices, vertexCount, region, points, coords);
+    vertexCount += vertices->size();
+}
+
+/**
+ * Drops what was left from the previous draw and builds the indices again
+ * if the meshes have changed.
+ **/
+void MeshBuffer::finish(void)
+{
+    if (parts.size() != partCount) {
+        parts.resize(partCount);
+        indicesValid = false;
+    }
+
+    if (vertexData.size() != vertexCount * 4) {
+        vertexData.resize(vertexCount * 4);
+        vertexUpload = true;
+    }
+
+    if (!indicesValid) {
+        buildIndices();
+        indicesValid = true;
+    }
+}
+
+/**
+ * Builds the vertex indices of the faces of the added meshes.
+ **/
+void MeshBuffer::buildIndices(void)
+{
+    unsigned count = 0;
+    for (unsigned p = 0; p < parts.size(); p++)
+        count += parts[p].faceCount;
+    indices.resize(count * 3);
+
+    GLuint *d = count ? &indices[0] : NULL;
+    GLuint base = 0;
+    for (unsigned p = 0; p < parts.size(); p++) {
+        vector<Vertex *> *vertices = parts[p].vertices;
+        vector<Face *> *faces = parts[p].faces;
+
+        map<Vertex *, GLuint> index;
+        for (unsigned i = 0; i < vertices->size(); i++)
+            index[(*vertices)[i]] = base + i;
+
+        for (unsigned i = 0; i < faces->size(); i++) {
+            Face *face = (*faces)[i];
+            for (int j = 0; j < 3; j++)
+                *d++ = index[face->v[j]];
+        }
+
+        base += vertices->size();
+    }
+
+    indexUpload = true;
+}
+
+/**
+ * Chooses the OpenGL texture to draw a mesh with. That is the atlas page of
+ * the texture if all the texture coordinates lie inside the texture,
+ * otherwise the neighbours of the texture on the page would show up instead
+ * of its clamped edges.
+ * \param vertices  vertices of the mesh
+ * \param texture   texture attached to the mesh
+ * \param resource  set to the OpenGL texture to bind
+ * \param region    set to the offset and size of the texture on the OpenGL
+ *                  texture
+ **/
+void MeshBuffer::selectTexture(vector<Vertex *> *vertices, Texture *texture,
+                               GLuint *resource, float *region)
+{
+    *resource = texture->getGlResource();
+    region[0] = region[1] = 0.f;
+    region[2] = region[3] = 1.f;
+
+    if (texture->getAtlasResource()) {
+        unsigned i = 0;
+        for (; i < vertices->size(); i++) {
+            const Vector2D& t = (*vertices)[i]->texCoord;
+            if ((t.x < 0.f) || (t.x > 1.f) || (t.y < 0.f) || (t.y > 1.f))
+                break;
+        }
+
+        if (i == vertices->size()) {
+            *resource = texture->getAtlasResource();
+            memcpy(region, texture->getAtlasRegion(), 4 * sizeof(float));
+        }
+    }
+}
+
+/**
+ * Copies the positions and texture coordinates of the vertices to the
+ * vertex data, and marks it for uploading if any of them has changed.
+ * \param vertices  vertices of the mesh
+ * \param offset    index of the first vertex in the vertex data
+ * \param region    offset and size of the texture on the bound OpenGL
+ *                  texture, the texture coordinates are mapped into it
+ * \param points    view coordinates of the vertices, two floats each, the
+ *                  ones stored in the vertices are used if NULL
+ * \param coords    layer coordinates of the vertices, the view coordinates
+ *                  are used if NULL, the vertex coordinates for the ones
+ *                  missing from it
+ **/
+void MeshBuffer::updateVertices(vector<Vertex *> *vertices, unsigned offset,
+                                const float *region, const float *points,
+                                const vector<Vector2D> *coords)
+{
+    unsigned count = vertices->size();
+    bool changed = false;
+
+    if (vertexData.size() < (offset + count) * 4) {
+        vertexData.resize((offset + count) * 4);
+        changed = true;
+    }
+
+    float *d = count ? &vertexData[offset * 4] : NULL;
+    for (unsigned i = 0; i < count; i++, d += 4) {
+        Vertex *v = (*vertices)[i];
+        float x = v->view.x;
+        float y = v->view.y;
+        if (coords) {
+            const Vector2D& p = (i < coords->size()) ? (*coords)[i] : v->coord;
+            x = p.x;
+            y = p.y;
+        }
+        else if (points) {
+            x = points[i * 2];
+            y = points[i * 2 + 1];
+        }
+
+        float s = region[0] + v->texCoord.x * region[2];
+        float t = region[1] + v->texCoord.y * region[3];
+
+        if ((d[0] != x) || (d[1] != y) || (d[2] != s) || (d[3] != t)) {
+            d[0] = x;
+            d[1] = y;
+            d[2] = s;
+            d[3] = t;
+            changed = true;
+        }
+    }
+
+    if (changed)
+        vertexUpload = true;
+}
+
+/**
+ * Builds the bone influences of the vertices from the attachments of the
+ * bones. A vertex keeps its SkinShader::MAX_INFLUENCES bones with the
+ * largest weights.
+ * \param vertices  vertices of the mesh
+ * \param skeleton  skeleton the vertices are attached to
+ * \param passes    number of times the vertices are pulled per frame, see
+ *                  SkinTable::skin()
+ **/
+void MeshBuffer::buildInfluences(vector<Vertex *> *vertices,
+                                 Skeleton *skeleton, int passes)
+{
+    const int n = SkinShader::MAX_INFLUENCES;
+
+    map<Vertex *, unsigned> index;
+    for (unsigned i = 0; i < vertices->size(); i++)
+        index[(*vertices)[i]] = i;
+
+    vector<Joint *> *joints = skeleton->getJoints();
+    map<Joint *, unsigned> jointIndex;
+    for (unsigned i = 0; i < joints->size(); i++)
+        jointIndex[(*joints)[i]] = i;
+
+    vector<Bone *> *bones = skeleton->getBones();
+    boneJoints.resize(bones->size() * 2);
+    boneData.resize(bones->size() * 4);
+
+    influenceData.assign(vertices->size() * n * 4, 0);
+    for (unsigned b = 0; b < bones->size(); b++) {
+        Bone *bone = (*bones)[b];
+        boneJoints[b * 2] = jointIndex[bone->j0];
+        boneJoints[b * 2 + 1] = jointIndex[bone->j1];
+
+        float *d, *w, *c, *s;
+        vector<Vertex *> *verts = bone->getAttachedVertices(&d, &w, &c, &s);
+        for (unsigned j = 0; j < verts->size(); j++) {
+            map<Vertex *, unsigned>::iterator i = index.find((*verts)[j]);
+            if (i == index.end())
+                continue;
+
+            /* the same weight a vertex is pulled with on the CPU */
+            float weight = w[j];
+            if (passes > 1)
+                weight = 1.0f - powf(1.0f - weight, (float)passes);
+
+            /* replace the bone with the smallest weight */
+            float *f = &influenceData[i->second * n * 4];
+            int slot = 0;
+            for (int k = 1; k < n; k++) {
+                if (f[n + k] < f[n + slot])
+                    slot = k;
+            }
+            if (f[n + slot] < weight) {
+                f[slot] = b;
+                f[n + slot] = weight;
+                f[n * 2 + slot] = c[j];
+                f[n * 3 + slot] = s[j];
+            }
+        }
+    }
+
+    influenceUpload = true;
+}
+
+/**
+ * Uploads the vertex and index buffers if they have changed.
+ **/
+void MeshBuffer::uploadBuffers(void)
+{
+    if (vertexBuffer == 0) {
+        glGenBuffers(1, &vertexBuffer);
+        vertexUpload = true;
+    }
+    if (indexBuffer == 0) {
+        glGenBuffers(1, &indexBuffer);
+        indexUpload = true;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    if (vertexUpload) {
+        glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(float),
+                     &vertexData[0], GL_STREAM_DRAW);
+        vertexUpload = false;
+    }
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    if (indexUpload) {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint),
+                     &indices[0], GL_STATIC_DRAW);
+        indexUpload = false;
+    }
+}
+
+/**
+ * Draws the faces of the meshes added since clear() as textured triangles,
+ * with the current texture and color.
+ **/
+void MeshBuffer::draw(void)
+{
+    finish();
+
+    if (indices.empty())
+        return;
+
+    const float *vertexPointer = &vertexData[0];
+    const GLuint *indexPointer = &indices[0];
+
+    bool buffers = hasBufferObjects();
+    if (buffers) {
+        uploadBuffers();
+
+        /* offsets into the bound buffers */
+        vertexPointer = NULL;
+        indexPointer = NULL;
+    }
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glVertexPointer(2, GL_FLOAT, 4 * sizeof(float), vertexPointer);
+    glTexCoordPointer(2, GL_FLOAT, 4 * sizeof(float), vertexPointer + 2);
+
+    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT,
+                   indexPointer);
+
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    if (buffers) {
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+}
+
+/**
+ * Draws the faces as textured triangles skinned by the bones of the
+ * skeleton in SkinShader, which has to be available. The skeleton can have
+ * at most SkinShader::MAX_BONES bones.
+ * \param vertices  vertices of the mesh
+ * \param coords    layer coordinates of the vertices, the vertex
+ *                  coordinates are used for the ones missing from it
+ * \param faces     faces of the mesh
+ * \param revision  revision of the mesh, changes when the faces or vertices
+ *                  are added, removed or reordered
+ * \param region    offset and size of the texture of the mesh on the bound
+ *                  OpenGL texture, see selectTexture()
+ * \param skeleton  skeleton the vertices are attached to, its last latched
+ *                  pose is drawn
+ * \param passes    number of times the vertices are pulled per frame, see
+ *                  SkinTable::skin()
+ * \param view      projection and modelview matrix of the layer, see
+ *                  SkinShader::begin()
+ * \param viewport  viewport the layer is projected to
+ **/
+void MeshBuffer::drawSkinned(vector<Vertex *> *vertices,
+                             const vector<Vector2D> *coords,
+                             vector<Face *> *faces, unsigned revision,
+                             const float *region, Skeleton *skeleton,
+                             int passes, const float *view,
+                             const float *viewport)
+{
+    const int n = SkinShader::MAX_INFLUENCES;
+
+    clear();
+    append(vertices, faces, revision, region, NULL, coords);
+    finish();
+
+    if (!influencesValid || (influenceRevision[0] != revision) ||
+        (influenceRevision[1] != skeleton->getRevision()) ||
+        (influencePasses != passes)) {
+        buildInfluences(vertices, skeleton, passes);
+        influenceRevision[0] = revision;
+        influenceRevision[1] = skeleton->getRevision();
+        influencePasses = passes;
+        influencesValid = true;
+    }
+
+    if (indices.empty())
+        return;
+
+    /* centre and direction of the bones in the drawn pose */
+    unsigned boneCount = boneJoints.size() / 2;
+    for (unsigned b = 0; b < boneCount; b++) {
+        const Vector2D& p0 = skeleton->getPosePosition(boneJoints[b * 2]);
+        const Vector2D& p1 = skeleton->getPosePosition(boneJoints[b * 2 + 1]);
+
+        float dx = p1.x - p0.x;
+        float dy = p1.y - p0.y;
+        float len = sqrtf(dx * dx + dy * dy);
+        if (len > FLT_EPSILON) {
+            dx /= len;
+            dy /= len;
+        }
+
+        boneData[b * 4] = (p0.x + p1.x) * .5f;
+        boneData[b * 4 + 1] = (p0.y + p1.y) * .5f;
+        boneData[b * 4 + 2] = dx;
+        boneData[b * 4 + 3] = dy;
+    }
+
+    uploadBuffers();
+
+    if (influenceBuffer == 0) {
+        glGenBuffers(1, &influenceBuffer);
+        influenceUpload = true;
+    }
+
+    SkinShader::begin(boneCount ? &boneData[0] : NULL, boneCount, view,
+                      viewport);
+
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glVertexPointer(2, GL_FLOAT, 4 * sizeof(float), NULL);
+    glTexCoordPointer(2, GL_FLOAT, 4 * sizeof(float),
+                      (const float *)NULL + 2);
+
+    glBindBuffer(GL_ARRAY_BUFFER, influenceBuffer);
+    if (influenceUpload) {
+        glBufferData(GL_ARRAY_BUFFER, influenceData.size() * sizeof(float),
+                     &influenceData[0], GL_STATIC_DRAW);
+        influenceUpload = false;
+    }
+    for (int a = 0; a < 4; a++) {
+        GLuint attrib = SkinShader::ATTRIB_BONE_INDEX + a;
+        glEnableVertexAttribArray(attrib);
+        glVertexAttribPointer(attrib, n, GL_FLOAT, GL_FALSE,
+                              n * 4 * sizeof(float),
+                              (const float *)NULL + n * a);
+    }
+
+    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, NULL);
+
+    for (int a = 0; a < 4; a++)
+        glDisableVertexAttribArray(SkinShader::ATTRIB_BONE_INDEX + a);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    SkinShader::end();
+}
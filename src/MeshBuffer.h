@@ -0,0 +1,143 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __MESHBUFFER_H__
+#define __MESHBUFFER_H__
+
+#if defined(__APPLE__)
+#include <OPENGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <vector>
+
+#include "Vertex.h"
+#include "Face.h"
+#include "Texture.h"
+
+using namespace std;
+
+namespace Animata
+{
+
+class Skeleton;
+
+/// Vertex and index buffers used to draw the textured faces of meshes.
+/**
+ * The view coordinates and texture coordinates of the vertices are kept
+ * interleaved in a vertex buffer object, the faces in an index buffer, so
+ * the meshes added to the buffer are drawn with a single glDrawElements()
+ * call. The vertex buffer is only uploaded again if the coordinates have
+ * changed, the index buffer if other meshes were added or their faces or
+ * vertices were added, removed or reordered. Client side vertex arrays are
+ * used if the OpenGL implementation does not support buffer objects.
+ *
+ * The texture coordinates are mapped to the TextureAtlas page of the
+ * texture when they all lie inside the texture, the coordinates stored in
+ * the vertices are left untouched.
+ *
+ * Skinned meshes keep their layer coordinates in the vertex buffer instead
+ * of the view coordinates, and the bones of every vertex in a static
+ * influence buffer read by SkinShader.
+ **/
+class MeshBuffer
+{
+public:
+    MeshBuffer();
+    ~MeshBuffer();
+
+    void clear(void);
+    void add(vector<Vertex *> *vertices, vector<Face *> *faces,
+             unsigned revision, const float *region,
+             const float *points = NULL);
+    void draw(void);
+
+    void drawSkinned(vector<Vertex *> *vertices,
+                     const vector<Vector2D> *coords, vector<Face *> *faces,
+                     unsigned revision, const float *region,
+                     Skeleton *skeleton, int passes, const float *view,
+                     const float *viewport);
+
+    static void selectTexture(vector<Vertex *> *vertices, Texture *texture,
+                              GLuint *resource, float *region);
+
+private:
+    /// A mesh added to the buffer.
+    struct Part
+    {
+        vector<Vertex *> *vertices;
+        vector<Face *> *faces;
+        unsigned revision;
+        unsigned vertexCount;
+        unsigned faceCount;
+    };
+
+    vector<Part> parts;     ///< meshes the indices were built from
+    unsigned partCount;     ///< number of meshes added since clear()
+    unsigned vertexCount;   ///< number of vertices added since clear()
+
+    /** view or layer and texture coordinates of the vertices, four floats
+     * each */
+    vector<float> vertexData;
+    vector<GLuint> indices;     ///< vertex indices of the faces
+    bool indicesValid;  ///< cleared if the indices have to be built again
+
+    GLuint vertexBuffer;    ///< vertex buffer object, 0 if not created
+    GLuint indexBuffer;     ///< index buffer object, 0 if not created
+    bool vertexUpload;      ///< set if the vertex buffer has to be uploaded
+    bool indexUpload;       ///< set if the index buffer has to be uploaded
+
+    /** bone indices, weights, cosine and sine offsets of every vertex, four
+     * of each */
+    vector<float> influenceData;
+    vector<unsigned> boneJoints;    ///< joint indices of the bones
+    vector<float> boneData;         ///< centre and direction of the bones
+
+    /** mesh revision, skeleton revision and passes of the influences */
+    unsigned influenceRevision[2];
+    int influencePasses;
+    bool influencesValid;   ///< set if the influences were built at all
+
+    GLuint influenceBuffer;     ///< influence buffer object, 0 if not created
+    bool influenceUpload;       ///< set if the influences have to be uploaded
+
+    void append(vector<Vertex *> *vertices, vector<Face *> *faces,
+                unsigned revision, const float *region, const float *points,
+                const vector<Vector2D> *coords);
+    void finish(void);
+    void buildIndices(void);
+    void updateVertices(vector<Vertex *> *vertices, unsigned offset,
+                        const float *region, const float *points,
+                        const vector<Vector2D> *coords);
+    void buildInfluences(vector<Vertex *> *vertices, Skeleton *skeleton,
+                         int passes);
+    void uploadBuffers(void);
+
+    static bool hasBufferObjects(void);
+};
+
+} /* namespace Animata */
+
+#endif
+
@@ -554,6 +554,9 @@ void OSCListener::ProcessMessage(const osc::ReceivedMessage& m,
         // any parsing errors get thrown as exceptions
         cerr << "OSC error: " << m.AddressPattern() << ": " << e.what() << "\n";
     }
+
+    /* the windows are drawn again after the changes of the message */
+    ui->editorBox->invalidateFrame();
 }
 
 void *OSCListener::threadFunc(void *p)
@@ -0,0 +1,385 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <math.h>
+#include <algorithm>
+
+#include "PickGrid.h"
+
+using namespace Animata;
+
+/**
+ * Creates an empty grid.
+ **/
+PickGrid::PickGrid()
+{
+    owner = NULL;
+    revision = 0;
+    viewRevision = 0;
+    count = 0;
+
+    cellSize = MIN_CELL;
+    cols = 0;
+    rows = 0;
+
+    mark = 0;
+}
+
+/**
+ * Checks whether the grid was built from the given primitives.
+ * \param owner         object the primitives belong to
+ * \param revision      revision of the object, changes when the primitives
+ *                      are added or removed
+ * \param viewRevision  changes when the view coordinates of the primitives
+ *                      change
+ * \param count         number of primitives of the object
+ * \retval bool true if the grid does not have to be built again
+ **/
+bool PickGrid::isCurrent(const void *owner, unsigned revision,
+                         unsigned viewRevision, unsigned count) const
+{
+    return owner && (this->owner == owner) &&
+           (this->revision == revision) &&
+           (this->viewRevision == viewRevision) &&
+           (this->count == count);
+}
+
+/**
+ * Removes the primitives from the grid to add the ones of the given object.
+ * Parameters are the same as of isCurrent(). The grid is ready to be queried
+ * after the primitives are added and build() is called.
+ **/
+void PickGrid::begin(const void *owner, unsigned revision,
+                     unsigned viewRevision, unsigned count)
+{
+    this->owner = owner;
+    this->revision = revision;
+    this->viewRevision = viewRevision;
+    this->count = count;
+
+    items.clear();
+}
+
+PickGrid::Item& PickGrid::add(unsigned type, unsigned name, int shape)
+{
+    items.resize(items.size() + 1);
+
+    Item& item = items.back();
+    item.type = type;
+    item.name = name;
+    item.shape = shape;
+    item.radius = 0;
+    return item;
+}
+
+/**
+ * Adds a filled square primitive, like a vertex.
+ * \param type      type of the primitive
+ * \param name      index of the primitive
+ * \param center    center of the square
+ * \param size      width of the square
+ **/
+void PickGrid::addRect(unsigned type, unsigned name, const Vector2D& center,
+                       float size)
+{
+    Item& item = add(type, name, SHAPE_RECT);
+    item.p[0] = center;
+    item.min = center - size * 0.5f;
+    item.max = center + size * 0.5f;
+}
+
+/**
+ * Adds a filled circle primitive, like a joint.
+ * \param type      type of the primitive
+ * \param name      index of the primitive
+ * \param center    center of the circle
+ * \param radius    radius of the circle
+ **/
+void PickGrid::addDisc(unsigned type, unsigned name, const Vector2D& center,
+                       float radius)
+{
+    Item& item = add(type, name, SHAPE_DISC);
+    item.p[0] = center;
+    item.radius = radius;
+    item.min = center - radius;
+    item.max = center + radius;
+}
+
+/**
+ * Adds a filled triangle primitive, like a face.
+ * \param type      type of the primitive
+ * \param name      index of the primitive
+ * \param a, b, c   corners of the triangle
+ **/
+void PickGrid::addTriangle(unsigned type, unsigned name, const Vector2D& a,
+                           const Vector2D& b, const Vector2D& c)
+{
+    Item& item = add(type, name, SHAPE_TRIANGLE);
+    item.p[0] = a;
+    item.p[1] = b;
+    item.p[2] = c;
+    item.min.set(min(a.x, min(b.x, c.x)), min(a.y, min(b.y, c.y)));
+    item.max.set(max(a.x, max(b.x, c.x)), max(a.y, max(b.y, c.y)));
+}
+
+/**
+ * Adds a line primitive, like a bone. The width of the line is not taken
+ * into account, just as in OpenGL selection mode.
+ * \param type      type of the primitive
+ * \param name      index of the primitive
+ * \param a, b      endpoints of the line
+ **/
+void PickGrid::addSegment(unsigned type, unsigned name, const Vector2D& a,
+                          const Vector2D& b)
+{
+    Item& item = add(type, name, SHAPE_SEGMENT);
+    item.p[0] = a;
+    item.p[1] = b;
+    item.min.set(min(a.x, b.x), min(a.y, b.y));
+    item.max.set(max(a.x, b.x), max(a.y, b.y));
+}
+
+/**
+ * Sorts the added primitives into the cells they overlap.
+ * The cells are sized to hold a few primitives each on average, and the
+ * primitives are counted first, so the cells are stored in one array
+ * without allocating memory for each of them.
+ **/
+void PickGrid::build(void)
+{
+    unsigned n = items.size();
+
+    cols = rows = 0;
+    cellStart.clear();
+    cellItems.clear();
+    if (marks.size() < n)
+        marks.resize(n, mark);
+
+    if (n == 0)
+        return;
+
+    Vector2D lo(items[0].min);
+    Vector2D hi(items[0].max);
+    for (unsigned i = 1; i < n; i++) {
+        lo.set(min(lo.x, items[i].min.x), min(lo.y, items[i].min.y));
+        hi.set(max(hi.x, items[i].max.x), max(hi.y, items[i].max.y));
+    }
+
+    float w = max(hi.x - lo.x, 1.f);
+    float h = max(hi.y - lo.y, 1.f);
+
+    cellSize = sqrtf(w * h / n);
+    cellSize = max(cellSize, (float)MIN_CELL);
+    cellSize = max(cellSize, max(w, h) / MAX_CELLS);
+
+    origin = lo;
+    cols = (int)(w / cellSize) + 1;
+    rows = (int)(h / cellSize) + 1;
+
+    /* count the items of every cell, cellStart[c + 1] holds the count of
+     * cell c first, then the prefix sums give the start of each cell */
+    cellStart.resize(cols * rows + 1, 0);
+    for (unsigned i = 0; i < n; i++) {
+        int c0, r0, c1, r1;
+        getCells(items[i].min, items[i].max, &c0, &r0, &c1, &r1);
+        for (int r = r0; r <= r1; r++)
+            for (int c = c0; c <= c1; c++)
+                cellStart[r * cols + c + 1]++;
+    }
+    for (int c = 0; c < cols * rows; c++)
+        cellStart[c + 1] += cellStart[c];
+
+    cellItems.resize(cellStart[cols * rows]);
+
+    /* fill the cells using the start indices as insertion points, then
+     * shift them back */
+    for (unsigned i = 0; i < n; i++) {
+        int c0, r0, c1, r1;
+        getCells(items[i].min, items[i].max, &c0, &r0, &c1, &r1);
+        for (int r = r0; r <= r1; r++)
+            for (int c = c0; c <= c1; c++)
+                cellItems[cellStart[r * cols + c]++] = i;
+    }
+    for (int c = cols * rows; c > 0; c--)
+        cellStart[c] = cellStart[c - 1];
+    cellStart[0] = 0;
+}
+
+/**
+ * Gets the range of cells overlapped by a rectangle.
+ * \param min, max  corners of the rectangle
+ * \param c0, r0    first column and row
+ * \param c1, r1    last column and row
+ * \retval bool false if the rectangle is outside of the grid
+ **/
+bool PickGrid::getCells(const Vector2D& min, const Vector2D& max, int *c0,
+                        int *r0, int *c1, int *r1) const
+{
+    float x0 = floorf((min.x - origin.x) / cellSize);
+    float y0 = floorf((min.y - origin.y) / cellSize);
+    float x1 = floorf((max.x - origin.x) / cellSize);
+    float y1 = floorf((max.y - origin.y) / cellSize);
+
+    if ((x1 < 0) || (y1 < 0) || (x0 >= cols) || (y0 >= rows))
+        return false;
+
+    *c0 = x0 < 0 ? 0 : (int)x0;
+    *r0 = y0 < 0 ? 0 : (int)y0;
+    *c1 = x1 >= cols ? cols - 1 : (int)x1;
+    *r1 = y1 >= rows ? rows - 1 : (int)y1;
+    return true;
+}
+
+/**
+ * Counts the corners of a rectangle on the two sides of a line.
+ * \param a, b      two points of the line
+ * \param corners   the four corners of the rectangle
+ * \param below     number of corners on the right side looking from \e a
+ *                  to \e b
+ * \param above     number of corners on the left side
+ **/
+static void countSides(const Vector2D& a, const Vector2D& b,
+                       const Vector2D *corners, int *below, int *above)
+{
+    Vector2D d(b - a);
+
+    *below = *above = 0;
+    for (int i = 0; i < 4; i++) {
+        Vector2D e(corners[i] - a);
+        float s = d.x * e.y - d.y * e.x;
+        *below += s < 0;
+        *above += s > 0;
+    }
+}
+
+/**
+ * Checks whether a primitive overlaps a rectangle. The triangles and lines
+ * are tested with separating axes: they miss the rectangle if their bounds
+ * do, or if the rectangle lies outside one of their edges.
+ * \param item      the primitive
+ * \param min, max  corners of the rectangle
+ * \retval bool true if the primitive overlaps the rectangle
+ **/
+bool PickGrid::intersects(const Item& item, const Vector2D& min,
+                          const Vector2D& max)
+{
+    if ((item.max.x < min.x) || (item.min.x > max.x) ||
+        (item.max.y < min.y) || (item.min.y > max.y))
+        return false;
+
+    const Vector2D corners[4] = {
+        min, Vector2D(max.x, min.y), max, Vector2D(min.x, max.y)
+    };
+
+    switch (item.shape) {
+        case SHAPE_DISC:
+        {
+            const Vector2D& c = item.p[0];
+            float dx = c.x < min.x ? min.x - c.x : (c.x > max.x ? c.x - max.x : 0);
+            float dy = c.y < min.y ? min.y - c.y : (c.y > max.y ? c.y - max.y : 0);
+            return dx * dx + dy * dy <= item.radius * item.radius;
+        }
+        case SHAPE_SEGMENT:
+        {
+            /* the rectangle is missed if all of its corners are on the same
+             * side of the line */
+            int below, above;
+            countSides(item.p[0], item.p[1], corners, &below, &above);
+            return (below < 4) && (above < 4);
+        }
+        case SHAPE_TRIANGLE:
+        {
+            /* the rectangle is missed if all of its corners are outside of an
+             * edge, on the other side than the third corner of the triangle,
+             * or on either side if the triangle is flat */
+            for (int k = 0; k < 3; k++) {
+                const Vector2D& a = item.p[k];
+                Vector2D d(item.p[(k + 1) % 3] - a);
+                Vector2D f(item.p[(k + 2) % 3] - a);
+                float side = d.x * f.y - d.y * f.x;
+
+                int below, above;
+                countSides(a, item.p[(k + 1) % 3], corners, &below, &above);
+                if (((side >= 0) && (below == 4)) ||
+                    ((side <= 0) && (above == 4)))
+                    return false;
+            }
+            return true;
+        }
+        default:
+            return true;
+    }
+}
+
+/**
+ * Finds the primitives overlapping a rectangle.
+ * \param p1, p2    opposite corners of the rectangle in view coordinates
+ * \param types     bitmask of the primitive types searched, bit \e n stands
+ *                  for type \e n
+ * \param hits      the found primitives get appended to it in the order they
+ *                  were added to the grid
+ **/
+void PickGrid::query(const Vector2D& p1, const Vector2D& p2, unsigned types,
+                     vector<SelectItem> *hits)
+{
+    Vector2D lo(min(p1.x, p2.x), min(p1.y, p2.y));
+    Vector2D hi(max(p1.x, p2.x), max(p1.y, p2.y));
+
+    int c0, r0, c1, r1;
+    if ((cols == 0) || !getCells(lo, hi, &c0, &r0, &c1, &r1))
+        return;
+
+    /* items spanning several cells are tested only once, the ones already
+     * visited by this query are marked */
+    if (++mark == 0) {
+        fill(marks.begin(), marks.end(), 0);
+        mark = 1;
+    }
+
+    found.clear();
+    for (int r = r0; r <= r1; r++) {
+        for (int c = c0; c <= c1; c++) {
+            unsigned end = cellStart[r * cols + c + 1];
+            for (unsigned k = cellStart[r * cols + c]; k < end; k++) {
+                unsigned i = cellItems[k];
+                if (marks[i] == mark)
+                    continue;
+                marks[i] = mark;
+
+                if ((types & (1 << items[i].type)) &&
+                    intersects(items[i], lo, hi))
+                    found.push_back(i);
+            }
+        }
+    }
+
+    sort(found.begin(), found.end());
+
+    for (unsigned i = 0; i < found.size(); i++) {
+        SelectItem hit;
+        hit.type = items[found[i]].type;
+        hit.name = items[found[i]].name;
+        hits->push_back(hit);
+    }
+}
+
@@ -0,0 +1,135 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __PICKGRID_H__
+#define __PICKGRID_H__
+
+#include <vector>
+
+#include "Vector2D.h"
+
+using namespace std;
+
+namespace Animata
+{
+
+/// Describes a picked primitive under the mouse cursor with its type and name.
+struct SelectItem
+{
+    unsigned int type;    ///< type of the selected primitive
+    unsigned int name;    ///< name of the selected primitive
+};
+
+/// Finds primitives by their view coordinates in a uniform screen grid.
+/**
+ * The primitives are added with the shape they are drawn with in the editor,
+ * then build() sorts them into the cells of a grid laid over their bounds.
+ * A query only tests the primitives in the cells the searched rectangle
+ * covers, and returns them in the order they were added, which is the order
+ * they are drawn in.
+ *
+ * The grid remembers what it was built from, see isCurrent(), so it is only
+ * built again when the primitives or their view coordinates change.
+ **/
+class PickGrid
+{
+public:
+    PickGrid();
+
+    bool isCurrent(const void *owner, unsigned revision,
+                   unsigned viewRevision, unsigned count) const;
+    void begin(const void *owner, unsigned revision, unsigned viewRevision,
+               unsigned count);
+    /// Forgets the primitives, so the grid is built again on the next use.
+    inline void invalidate(void) { owner = NULL; }
+
+    void addRect(unsigned type, unsigned name, const Vector2D& center,
+                 float size);
+    void addDisc(unsigned type, unsigned name, const Vector2D& center,
+                 float radius);
+    void addTriangle(unsigned type, unsigned name, const Vector2D& a,
+                     const Vector2D& b, const Vector2D& c);
+    void addSegment(unsigned type, unsigned name, const Vector2D& a,
+                    const Vector2D& b);
+    void build(void);
+
+    void query(const Vector2D& p1, const Vector2D& p2, unsigned types,
+               vector<SelectItem> *hits);
+
+private:
+    /// Shapes of the primitives.
+    enum {
+        SHAPE_RECT = 0,
+        SHAPE_DISC,
+        SHAPE_TRIANGLE,
+        SHAPE_SEGMENT
+    };
+
+    /// A primitive with its shape in view coordinates.
+    struct Item
+    {
+        unsigned type;      ///< type of the primitive as in Selection
+        unsigned name;      ///< index of the primitive
+        int shape;          ///< one of the shapes above
+        Vector2D p[3];      ///< points of the shape
+        float radius;       ///< radius of a disc
+        Vector2D min;       ///< lower corner of the bounds
+        Vector2D max;       ///< upper corner of the bounds
+    };
+
+    /** smallest cell size in pixels, a cell is about the size of a few
+     * vertices drawn next to each other */
+    static const int MIN_CELL = 16;
+    /// largest number of cells along an axis
+    static const int MAX_CELLS = 256;
+
+    const void *owner;      ///< object the primitives came from
+    unsigned revision;      ///< revision of the owner
+    unsigned viewRevision;  ///< revision of the owner's view coordinates
+    unsigned count;         ///< number of primitives of the owner
+
+    vector<Item> items;     ///< primitives in the order they were added
+
+    Vector2D origin;        ///< lower corner of the grid
+    float cellSize;         ///< width and height of a cell
+    int cols;               ///< number of columns
+    int rows;               ///< number of rows
+
+    vector<unsigned> cellStart; ///< first index in \a cellItems of each cell
+    vector<unsigned> cellItems; ///< items of the cells, cell by cell
+
+    vector<unsigned> marks; ///< query the items were last visited by
+    unsigned mark;          ///< number of the current query
+    vector<unsigned> found; ///< items found by the current query
+
+    Item& add(unsigned type, unsigned name, int shape);
+    bool getCells(const Vector2D& min, const Vector2D& max, int *c0, int *r0,
+                  int *c1, int *r1) const;
+    static bool intersects(const Item& item, const Vector2D& min,
+                           const Vector2D& max);
+};
+
+} /* namespace Animata */
+
+#endif
+
@@ -38,13 +38,12 @@ Playback::Playback(int x, int y, int w, int h, const char* l) :
     Fl_Gl_Window(x, y, w, h, l)
 {
     camera = new Camera();
+    drawList = new DrawList();
     // rootLayer = NULL;
     allLayers = NULL;
 
     fullscreen = 0;
     this->resizable(this);
-
-    glContext = NULL;
 }
 
 /**
@@ -52,6 +51,7 @@ Playback::Playback(int x, int y, int w, int h, const char* l) :
  */
 Playback::~Playback()
 {
+    delete drawList;
     delete camera;
 }
 
@@ -66,11 +66,9 @@ void Playback::draw()
         camera->setSize(Vector2D(w(), h()));
     }
 
-    // FIXME: somehow the context of the editorwindow has feedback on the
-    // playbackwindow's context on windows
-    // setting the viewport in the editorwindow causes to change it in the
-    // playbackwindow too
-    // camera->setupViewport();
+    /* the projection and the viewport are set in every frame, as the context
+     * is shared with the editor, and Transform keeps the ones loaded last */
+    camera->setupPerspective();
 
     glClearColor(0, 0, 0, 0);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -78,11 +76,23 @@ void Playback::draw()
     camera->setupModelView();
 
     if (allLayers) {
-        vector<Layer *>::iterator l = allLayers->begin();
-        for (; l < allLayers->end(); l++) {
-            (*l)->drawWithoutRecursion(RENDER_FEEDBACK | RENDER_OUTPUT
-                                       | RENDER_TEXTURE | RENDER_WIREFRAME);
-        }
+        /* nothing is calculated again if the editor has already drawn the
+         * changes */
+        ui->editorBox->updateTransformations();
+
+        bool wireframe = ui->settings.display_elements &
+                         (DISPLAY_OUTPUT_VERTEX | DISPLAY_OUTPUT_TRIANGLE |
+                          DISPLAY_OUTPUT_JOINT | DISPLAY_OUTPUT_BONE);
+
+        /* the view coordinates of this window are kept in the draw list, the
+         * ones in the vertices and joints belong to the editor */
+        drawList->draw(allLayers, RENDER_OUTPUT | RENDER_TEXTURE |
+                                  (wireframe ? RENDER_WIREFRAME : 0));
+
+        /* the wireframe is drawn over all the textures, as in the editor,
+         * from the view coordinates of this window */
+        if (wireframe)
+            drawList->drawWireframe();
     }
 }
 
@@ -126,13 +136,14 @@ int Playback::handle(int event)
 
 /**
  * Overrides Fl_Gl_Window::show() so it wont create a new opengl context every time.
- * \todo This function is not implemented.
+ * The window draws with the context of the editor window, so the textures,
+ * atlas pages and vertex buffers are only uploaded once. The context is not
+ * destroyed with this window. If the editor has no context yet, a new one is
+ * created.
  */
 void Playback::show()
 {
-    // context should be recreated, because on win the old one wont be used
-    // TODO: reuse the main window's context
-    context(NULL);
+    context(ui->editorBox->context(), 0);
 
     Fl_Gl_Window::show();
 }
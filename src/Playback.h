@@ -56,13 +56,13 @@ private:
     ///< Every layer on the scene, same as AnimataWindow::allLayers.
     std::vector<Layer *> *allLayers;
 
+    DrawList *drawList;     ///< batches of the textured layers
+
     bool fullscreen;    ///< fullscreen flag
 
     ///< last position of the playback window before it has been but to fullscreen
     int ox, oy, ow, oh;
 
-    void *glContext;    ///< OpenGL context of this window
-
 public:
 
     Playback(int x, int y, int w, int h, const char* l = NULL);
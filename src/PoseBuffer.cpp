@@ -0,0 +1,100 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "PoseBuffer.h"
+
+using namespace Animata;
+
+PoseBuffer::PoseBuffer()
+{
+    for (int i = 0; i < 3; i++) {
+        buffers[i] = new vector<Vector2D>;
+        revisions[i] = 0;
+    }
+
+    back = 0;
+    ready = 1;
+    front = 2;
+    fresh = false;
+    last = NULL;
+    lastRevision = 0;
+
+    pthread_mutex_init(&mutex, NULL);
+}
+
+PoseBuffer::~PoseBuffer()
+{
+    pthread_mutex_destroy(&mutex);
+
+    for (int i = 0; i < 3; i++)
+        delete buffers[i];
+}
+
+/**
+ * Publishes the back buffer filled by the writer, and gives the writer the
+ * previously published one to fill next time. Nothing is published if the
+ * back buffer is the same as the last published one, the reader only reads
+ * that one so it can be compared to without locking.
+ * \param revision  revision of the points the back buffer was filled from
+ * \return true if the buffer was published
+ **/
+bool PoseBuffer::publish(unsigned revision /* = 0 */)
+{
+    if (last && (*buffers[back] == *last) && (lastRevision == revision))
+        return false;
+
+    revisions[back] = revision;
+
+    pthread_mutex_lock(&mutex);
+    int t = ready;
+    ready = back;
+    back = t;
+    fresh = true;
+    last = buffers[ready];
+    lastRevision = revision;
+    pthread_mutex_unlock(&mutex);
+
+    return true;
+}
+
+/**
+ * Makes the latest published buffer the front buffer.
+ * \return true if a new snapshot was latched
+ **/
+bool PoseBuffer::latch(void)
+{
+    bool latched = false;
+
+    pthread_mutex_lock(&mutex);
+    if (fresh) {
+        int t = front;
+        front = ready;
+        ready = t;
+        fresh = false;
+        latched = true;
+    }
+    pthread_mutex_unlock(&mutex);
+
+    return latched;
+}
+
@@ -0,0 +1,83 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __POSEBUFFER_H__
+#define __POSEBUFFER_H__
+
+#include <pthread.h>
+#include <vector>
+
+#include "Vector2D.h"
+
+using namespace std;
+
+namespace Animata
+{
+
+/// Triple buffered snapshot of point positions.
+/**
+ * The simulation thread fills the back buffer and publishes it, the drawing
+ * thread latches the latest published buffer once per frame. Neither side
+ * waits for the other longer than a pointer swap. A buffer equal to the
+ * last published one is not published again, so latch() only reports
+ * positions that have changed. Every buffer is stamped with the revision of
+ * the points it was filled from, so the reader can tell whether its indices
+ * still match the points.
+ **/
+class PoseBuffer
+{
+public:
+    PoseBuffer();
+    ~PoseBuffer();
+
+    /// Returns the buffer to be filled by the writer.
+    inline vector<Vector2D> *getBack(void) { return buffers[back]; }
+    bool publish(unsigned revision = 0);
+
+    bool latch(void);
+    /// Returns the snapshot latched by the reader.
+    inline const vector<Vector2D> *getFront(void) const
+        { return buffers[front]; }
+    /// Returns the revision the snapshot latched by the reader was filled at.
+    inline unsigned getFrontRevision(void) const
+        { return revisions[front]; }
+
+private:
+    vector<Vector2D> *buffers[3];
+    unsigned revisions[3];  ///< revisions the buffers were filled at
+    int back;       ///< buffer owned by the writer
+    int ready;      ///< latest published buffer
+    int front;      ///< buffer owned by the reader
+    bool fresh;     ///< true if ready has not been latched yet
+    /** buffer published last, which is never given back to the writer
+     * before the next publish */
+    const vector<Vector2D> *last;
+    unsigned lastRevision;  ///< revision of the buffer published last
+
+    pthread_mutex_t mutex;
+};
+
+} /* namespace Animata */
+
+#endif
+
@@ -27,6 +27,7 @@
 #include "Bone.h"
 #include "Joint.h"
 #include "Layer.h"
+#include "Selection.h"
 
 using namespace Animata;
 
@@ -67,12 +68,26 @@ void Primitives::drawCrossHairs(Layer *l)
 
 void Primitives::drawBone(Bone *b, int mouseOver, int active)
 {
-    Vector2D d(b->j1->viewPosition - b->j0->viewPosition);
+    drawBone(b, b->j0->viewPosition, b->j1->viewPosition, mouseOver, active);
+}
+
+/**
+ * Draws the bone between the given view coordinates of its joints.
+ * \param b     the bone
+ * \param p0    view coordinates of the first joint
+ * \param p1    view coordinates of the second joint
+ * \param mouseOver 1 if the mouse is over the bone
+ * \param active    1 if the bone is on the active layer
+ */
+void Primitives::drawBone(Bone *b, const Vector2D& p0, const Vector2D& p1,
+                          int mouseOver, int active)
+{
+    Vector2D d(p1 - p0);
     d.normalize();
     d *= boneSize;
 
-    Vector2D v1(b->j0->viewPosition + d);
-    Vector2D v2(b->j1->viewPosition - d);
+    Vector2D v1(p0 + d);
+    Vector2D v2(p1 - d);
 
     float size = b->damp*3;
 
@@ -108,6 +123,22 @@ void Primitives::drawBone(Bone *b, int mouseOver, int active)
     }
 }
 
+/**
+ * Adds the bone to the grid with the line it is drawn with.
+ * \param grid  the grid used for picking
+ * \param i     index of the bone in the skeleton
+ * \param b     the bone
+ */
+void Primitives::pickBone(PickGrid *grid, unsigned i, Bone *b)
+{
+    Vector2D d(b->j1->viewPosition - b->j0->viewPosition);
+    d.normalize();
+    d *= boneSize;
+
+    grid->addSegment(Selection::SELECT_BONE, i, b->j0->viewPosition + d,
+                     b->j1->viewPosition - d);
+}
+
 void Primitives::drawBoneWhileConnecting(const Vector2D& p1, const Vector2D& p2)
 {
     stroke(true);
@@ -123,15 +154,25 @@ void Primitives::drawBoneWhileConnecting(const Vector2D& p1, const Vector2D& p2)
 
 void Primitives::drawJoint(Joint *j, int mouseOver, int active)
 {
-//    float x = j->vx;
-//    float y = j->vy;
+    drawJoint(j, j->viewPosition, mouseOver, active);
+}
 
+/**
+ * Draws the joint at the given view coordinates.
+ * \param j     the joint
+ * \param p     view coordinates of the joint
+ * \param mouseOver 1 if the mouse is over the joint
+ * \param active    1 if the joint is on the active layer
+ */
+void Primitives::drawJoint(Joint *j, const Vector2D& p, int mouseOver,
+                           int active)
+{
     int alpha = active ? 0 : dAlpha;
 
     stroke(false);
     fill(true);
     fillColor(0, 0, 0, 128 - alpha);
-    drawCircle(j->viewPosition, jointSize + border);
+    drawCircle(p, jointSize + border);
 
     if (mouseOver) {
         stroke(true);
@@ -157,19 +198,44 @@ void Primitives::drawJoint(Joint *j, int mouseOver, int active)
         strokeColor(255, 255, 255, 200 - alpha);
     }
     strokeWeight(2);
-    drawCircle(j->viewPosition, jointSize);
+    drawCircle(p, jointSize);
 }
 
 ///////////////////////////////    VERTEX   //////////////////////////////////
 
+/**
+ * Adds the joint to the grid with the circle it is drawn with.
+ * \param grid  the grid used for picking
+ * \param i     index of the joint in the skeleton
+ * \param j     the joint
+ */
+void Primitives::pickJoint(PickGrid *grid, unsigned i, Joint *j)
+{
+    grid->addDisc(Selection::SELECT_JOINT, i, j->viewPosition,
+                  jointSize + border);
+}
+
 void Primitives::drawVertex(Vertex *v, int mouseOver, int active)
+{
+    drawVertex(v, v->view, mouseOver, active);
+}
+
+/**
+ * Draws the vertex at the given view coordinates.
+ * \param v     the vertex
+ * \param p     view coordinates of the vertex
+ * \param mouseOver 1 if the mouse is over the vertex
+ * \param active    1 if the vertex is on the active layer
+ */
+void Primitives::drawVertex(Vertex *v, const Vector2D& p, int mouseOver,
+                            int active)
 {
     int alpha = active ? 0 : dAlpha;
 
     fill(true);
     stroke(false);
     fillColor(0,0,0,128 - alpha);
-    drawRect(v->view, vertexSize + border);
+    drawRect(p, vertexSize + border);
 
     if (mouseOver) {
         stroke(true);
@@ -190,22 +256,58 @@ void Primitives::drawVertex(Vertex *v, int mouseOver, int active)
     }
 
     strokeWeight(1);
-    drawRect(v->view, vertexSize);
+    drawRect(p, vertexSize);
+}
+
+/**
+ * Adds the vertex to the grid with the rectangle it is drawn with.
+ * \param grid  the grid used for picking
+ * \param i     index of the vertex in the mesh
+ * \param v     the vertex
+ */
+void Primitives::pickVertex(PickGrid *grid, unsigned i, Vertex *v)
+{
+    grid->addRect(Selection::SELECT_VERTEX, i, v->view, vertexSize + border);
 }
 
 void Primitives::drawVertexAttached(Vertex *v)
+{
+    drawVertexAttached(v->view);
+}
+
+/**
+ * Marks an attached vertex at the given view coordinates.
+ * \param p     view coordinates of the vertex
+ */
+void Primitives::drawVertexAttached(const Vector2D& p)
 {
     fill(false);
     stroke(true);
     strokeColor(255,0,0,128);
     strokeWeight(1);
-    drawRect(v->view, vertexSize + border * 2);
+    drawRect(p, vertexSize + border * 2);
 }
 
 
 ///////////////////////////////    FACE     //////////////////////////////////
 
 void Primitives::drawFace(Face *face, int mouseOver /* = 0 */, int active)
+{
+    drawFace(face->v[0]->view, face->v[1]->view, face->v[2]->view, mouseOver,
+             active);
+}
+
+/**
+ * Draws a face between the given view coordinates of its vertices.
+ * \param p1    view coordinates of the first vertex
+ * \param p2    view coordinates of the second vertex
+ * \param p3    view coordinates of the third vertex
+ * \param mouseOver 1 if the mouse is over the face
+ * \param active    1 if the face is on the active layer
+ */
+void Primitives::drawFace(const Vector2D& p1, const Vector2D& p2,
+                          const Vector2D& p3, int mouseOver /* = 0 */,
+                          int active /* = 1 */)
 {
     int alpha = active ? 0 : dAlpha;
 
@@ -220,7 +322,19 @@ void Primitives::drawFace(Face *face, int mouseOver /* = 0 */, int active)
         strokeColor(255, 255, 255, 200 - alpha);
         fillColor(0, 0, 0, 42);
     }
-    drawTriangle(face->v[0]->view, face->v[1]->view, face->v[2]->view);
+    drawTriangle(p1, p2, p3);
+}
+
+/**
+ * Adds the face to the grid as a filled triangle.
+ * \param grid  the grid used for picking
+ * \param i     index of the face in the mesh
+ * \param face  the face
+ */
+void Primitives::pickFace(PickGrid *grid, unsigned i, Face *face)
+{
+    grid->addTriangle(Selection::SELECT_TRIANGLE, i, face->v[0]->view,
+                      face->v[1]->view, face->v[2]->view);
 }
 
 void Primitives::drawFaceWhileConnecting(const Vector2D& p1, const Vector2D& p2)
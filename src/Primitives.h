@@ -27,6 +27,7 @@
 #include "Bone.h"
 #include "Joint.h"
 #include "Layer.h"
+#include "PickGrid.h"
 
 #define fillColor(r, g, b, a) \
 { \
@@ -55,14 +56,24 @@ public:
     static void drawCrossHairs(Layer *l);
 
     static void drawBone(Bone *b, int mouseOver, int active);
+    static void drawBone(Bone *b, const Vector2D& p0, const Vector2D& p1,
+                         int mouseOver, int active);
     static void drawBoneWhileConnecting(const Vector2D& p1, const Vector2D& p2);
 
     static void drawJoint(Joint *j, int mouseOver, int active);
+    static void drawJoint(Joint *j, const Vector2D& p, int mouseOver,
+                          int active);
 
     static void drawVertex(Vertex *v, int mouseOver, int active);
+    static void drawVertex(Vertex *v, const Vector2D& p, int mouseOver,
+                           int active);
     static void drawVertexAttached(Vertex *v);
+    static void drawVertexAttached(const Vector2D& p);
 
     static void drawFace(Face *face, int mouseOver = 0, int active = 1);
+    static void drawFace(const Vector2D& p1, const Vector2D& p2,
+                         const Vector2D& p3, int mouseOver = 0,
+                         int active = 1);
     static void drawFaceWhileConnecting(const Vector2D& p1, const Vector2D& p2);
 
     static void drawSelectionBox(const Vector2D& p1, const Vector2D& p2);
@@ -78,6 +89,11 @@ public:
     static void drawTriangle(const Vector2D& p1, const Vector2D& p2,
                              const Vector2D& p3);
 
+    static void pickBone(PickGrid *grid, unsigned i, Bone *b);
+    static void pickJoint(PickGrid *grid, unsigned i, Joint *j);
+    static void pickVertex(PickGrid *grid, unsigned i, Vertex *v);
+    static void pickFace(PickGrid *grid, unsigned i, Face *face);
+
 private:
 
     static float fillColorR;
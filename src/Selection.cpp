@@ -22,404 +22,218 @@
 */
 
 #include <stdio.h>
+#include <algorithm>
 
 #include "Selection.h"
+#include "Primitives.h"
 #include "Transform.h"
+#include "animataUI.h"
 
 using namespace Animata;
 
 /**
- * Creates a new selection object which is responsible for picking, selection
- * and feedback.  Buffers for OpenGL and also for storing picked primitives are
- * allocated with it's default size.
+ * Creates a new selection object which is responsible for picking and
+ * selection.
  */
 Selection::Selection()
 {
-    hitCount = 0;
-
-    selectBuffer = new GLuint[BUFSIZE];
-    feedBuffer = new float[BUFSIZE];
-
-    selectedLength = MAXHIT_INIT;
-    selected = new SelectItem[selectedLength];
-
-    pointsLength = 8190;
-    points = new float[pointsLength];
-
     pickLayer = NULL;
 }
 
 /**
- * Deletes the selection object and frees up the memory allocated by it.
+ * Deletes the selection object.
  */
 Selection::~Selection()
 {
-    delete [] selectBuffer;
-    delete [] feedBuffer;
-    delete [] selected;
-    delete [] points;
 }
 
-        /// starts the picking on given coordinates
 /**
- * Drawing the mesh, skeleton and tetxure in GL_SELECT mode, deterimes which of
- * their building blocks are in radius of the given coordinate.  This can be
- * used for getting objects under the mouse cursor if called with the mouse
- * coordinates.  Searching radius is read from \a radius.  The found primitives
- * are then saved in the \a selected array, which elements hold each primitive's
- * type and name.  Camera is used to determine the projection matrix for picking
- * based on the camera properties.
- *
- * \param camera            The camera used for the scene.
- * \param layer             Mesh and skeleton gets searched from this layer.
- * \param textureManager    TextureManager which holds the texture attached to
- *                          the mesh on the given layer.
- * \param c                 Coordinates of the searching center.
+ * Builds \a meshGrid from the faces and vertices of the mesh, unless it was
+ * built from them already and their view coordinates have not changed since.
+ * The primitives get the shape and the size they are drawn with in
+ * Mesh::draw().
+ * \param mesh  The mesh to search in.
  */
-void Selection::doPick(Camera *camera, Layer *layer,
-                       TextureManager *textureManager, const Vector2D& center)
+void Selection::updateGrid(Mesh *mesh)
 {
-    GLint hits;
-
-    // invalidate hits; if hit is valid during changing the actual layer in
-    // the laterTree, there could be an invalid selection on the new layer
-    // coming from the old one
-    // TODO: use setPickLayer when changing layer
-    if (layer != pickLayer)
-        hitCount = 0;
+    vector<Vertex *> *vertices = mesh->getVertices();
+    vector<Face *> *faces = mesh->getFaces();
+    unsigned count = vertices->size() + faces->size();
 
-    pickLayer = layer;
-
-    // start selection mode
-    glSelectBuffer(BUFSIZE, selectBuffer);
-    (void)glRenderMode(GL_SELECT);
+    if (meshGrid.isCurrent(mesh, mesh->getRevision(),
+                           mesh->getViewRevision(), count))
+        return;
 
-    // clear the name stack, push initial name on it
-    glInitNames();
-    glPushName(0);
+    meshGrid.begin(mesh, mesh->getRevision(), mesh->getViewRevision(),
+                   count);
 
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
+    for (unsigned i = 0; i < faces->size(); i++)
+        Primitives::pickFace(&meshGrid, i, (*faces)[i]);
+    for (unsigned i = 0; i < vertices->size(); i++)
+        Primitives::pickVertex(&meshGrid, i, (*vertices)[i]);
 
-    camera->setupPickingProjection(center, radius);
+    meshGrid.build();
+}
 
-    /* Drawing happens in ortho mode without any transformation in the modelview
-     * matrix */
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
+/**
+ * Builds \a skeletonGrid from the bones and joints of the skeleton, unless it
+ * was built from them already and their view coordinates have not changed
+ * since. The primitives get the shape and the size they are drawn with in
+ * Skeleton::draw().
+ * \param skeleton  The skeleton to search in.
+ */
+void Selection::updateGrid(Skeleton *skeleton)
+{
+    vector<Joint *> *joints = skeleton->getJoints();
+    vector<Bone *> *bones = skeleton->getBones();
+    unsigned count = joints->size() + bones->size();
 
-    if (layer->getMesh()->getAttachedTexture())
-        layer->getMesh()->getAttachedTexture()->draw();
+    if (skeletonGrid.isCurrent(skeleton, skeleton->getRevision(),
+                               skeleton->getViewRevision(), count))
+        return;
 
-    // draw only the current layer, no sublayers
-    layer->getMesh()->draw(RENDER_TEXTURE | RENDER_WIREFRAME);
-    layer->getSkeleton()->draw(RENDER_TEXTURE | RENDER_WIREFRAME);
+    skeletonGrid.begin(skeleton, skeleton->getRevision(),
+                       skeleton->getViewRevision(), count);
 
-    glMatrixMode(GL_MODELVIEW);
-    glPopMatrix();
+    for (unsigned i = 0; i < bones->size(); i++)
+        Primitives::pickBone(&skeletonGrid, i, (*bones)[i]);
+    for (unsigned i = 0; i < joints->size(); i++)
+        Primitives::pickJoint(&skeletonGrid, i, (*joints)[i]);
 
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix();
-    glFlush();
+    skeletonGrid.build();
+}
 
-    // go back to render mode, and process selection buffer
-    hits = glRenderMode(GL_RENDER);
-    processHits(hits, selectBuffer);
+/**
+ * Returns the primitive types shown in the editor window, the others cannot
+ * be picked or selected.
+ * \retval unsigned Bitmask of the types, bit \e n stands for type \e n.
+ */
+unsigned Selection::getDisplayedTypes(void)
+{
+    int display = ui->settings.display_elements;
+    unsigned types = 0;
+
+    if (display & DISPLAY_EDITOR_TRIANGLE)
+        types |= 1 << SELECT_TRIANGLE;
+    if (display & DISPLAY_EDITOR_VERTEX)
+        types |= 1 << SELECT_VERTEX;
+    if (display & DISPLAY_EDITOR_BONE)
+        types |= 1 << SELECT_BONE;
+    if (display & DISPLAY_EDITOR_JOINT)
+        types |= 1 << SELECT_JOINT;
+
+    return types;
 }
 
-void Selection::processHits(unsigned hits, GLuint buffer[])
+/**
+ * Determines which building blocks of the mesh and skeleton are in radius of
+ * the given coordinate.  This can be used for getting objects under the mouse
+ * cursor if called with the mouse coordinates.  Searching radius is read from
+ * \a radius.  The found primitives are then saved in the \a selected array,
+ * which elements hold each primitive's type and name, in the order the
+ * primitives are drawn: faces, vertices, bones then joints.
+ *
+ * \param camera    The camera used for the scene, the coordinates are
+ *                  mirrored to the view coordinates with its viewport.
+ * \param layer     Mesh and skeleton gets searched from this layer.
+ * \param center    Coordinates of the searching center.
+ */
+void Selection::doPick(Camera *camera, Layer *layer, const Vector2D& center)
 {
-    /* every hit record has 4 item
-     * - the number of names on the stack when the hit occured
-     * - the min/max window coordinate z values of all the vertices of the
-     *   primitive that intersected the viewing volume
-     * - contents of the name stack at the time of the hit, starting with the
-     *   bottommost element first */
-
-    GLuint found = 0;
-    GLuint *ptr = (GLuint*)buffer;
-
-    hitCount = 0;
-
-    /* if selected array is to small to store hits, allocate a new one with hits
-     * length */
-    if (hits > selectedLength) {
-        delete [] selected;
-        selectedLength = hits;
-        selected = new SelectItem[selectedLength];
-    }
-
-    for (unsigned i = 0; i < hits; i++) {
-        GLuint names = *ptr;
-        ptr += 3;
-        for (GLuint j = 0; j < names; j++) {
-            found = *ptr;
-            if (j == 0) {
-                selected[hitCount].type = found;
-            }
-            else if (j == 1) {
-                selected[hitCount++].name = found;
-            }
-            ptr++;
-        }
-    }
+    pickLayer = layer;
+    selected.clear();
+
+    updateGrid(layer->getMesh());
+    updateGrid(layer->getSkeleton());
+
+    /* the mouse coordinates grow downwards, the view coordinates upwards
+     * from the bottom of the viewport */
+    Vector2D c(center.x, camera->getViewport()[3] - center.y);
+    Vector2D p1(c - radius * 0.5f);
+    Vector2D p2(c + radius * 0.5f);
+
+    unsigned types = getDisplayedTypes();
+
+    // search only the current layer, no sublayers
+    meshGrid.query(p1, p2, types, &selected);
+    skeletonGrid.query(p1, p2, types, &selected);
 }
 
 /**
- * Selects the building elements of \c type from \c node in the given rectangle
- * by calling select() for each element.
- * \c node has to be an inherited from Drawable, so it gets a valid select()
- * \param node  The an object inherited from Drawable which gets searched for
- *              its primitives.
+ * Selects the vertices of the mesh in the given rectangle by calling select()
+ * for each vertex.
+ * \param mesh  The mesh which gets searched for its primitives.
  * \param type  Type of primitive which are searched.
  * \param pos   \e Coordinates of the searching rectangle's upper left corner.
- * \param dim   Dimensions of the searching rectangle.
+ * \param dim   \e Coordinates of the opposite corner.
  * \sa doCircleSelect()
  */
-void Selection::doSelect(Drawable *node, unsigned type, const Vector2D& pos,
+void Selection::doSelect(Mesh *mesh, unsigned type, const Vector2D& pos,
                          const Vector2D& dim)
 {
-    GLint hits;
+    float viewport[4];
+    Transform::getViewport(viewport);
 
-    // get the boundaries of actual viewport
-    GLint viewport[4];
-    glGetIntegerv(GL_VIEWPORT, viewport);
+    updateGrid(mesh);
 
-    // start selection mode
-    glSelectBuffer(BUFSIZE, selectBuffer);
-    (void)glRenderMode(GL_SELECT);
+    // mirror the screen along y coordinate because of the different coordinate systems
+    vector<SelectItem> hits;
+    meshGrid.query(Vector2D(pos.x, viewport[3] - pos.y),
+                   Vector2D(dim.x, viewport[3] - dim.y),
+                   getDisplayedTypes() & (1 << type), &hits);
 
-    // clear the name stack, push initial name on it
-    glInitNames();
-    glPushName(0);
+    for (unsigned i = 0; i < hits.size(); i++)
+        mesh->select(hits[i].name, type);
+}
 
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
+/**
+ * Selects the joints of the skeleton in the given rectangle by calling
+ * select() for each joint.
+ * \param skeleton  The skeleton which gets searched for its primitives.
+ * \param type      Type of primitive which are searched.
+ * \param pos       \e Coordinates of the searching rectangle's upper left
+ *                  corner.
+ * \param dim       \e Coordinates of the opposite corner.
+ */
+void Selection::doSelect(Skeleton *skeleton, unsigned type,
+                         const Vector2D& pos, const Vector2D& dim)
+{
+    float viewport[4];
+    Transform::getViewport(viewport);
 
-    // mirror the screen along y coordinate because of the different coordinate systems
-    glOrtho(pos.x, dim.x, viewport[3] - dim.y, viewport[3] - pos.y, -1, 1);
-
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    node->draw(RENDER_TEXTURE | RENDER_WIREFRAME);
-
-    // restore the projection matrix
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix();
-    glFlush();
-
-    // go back to render mode, and process selection buffer
-    hits = glRenderMode(GL_RENDER);
-
-    GLuint *ptr = (GLuint*)selectBuffer;
-
-    for (GLint i = 0; i < hits; i++) {
-        GLuint names = *ptr;
-        ptr += 3;
-        if (names == 2 && *ptr == type) {
-            ptr++;
-            node->select(*ptr, type);
-            ptr++;
-        }
-        else {
-            ptr += names;
-        }
-    }
+    updateGrid(skeleton);
+
+    vector<SelectItem> hits;
+    skeletonGrid.query(Vector2D(pos.x, viewport[3] - pos.y),
+                       Vector2D(dim.x, viewport[3] - dim.y),
+                       getDisplayedTypes() & (1 << type), &hits);
+
+    for (unsigned i = 0; i < hits.size(); i++)
+        skeleton->select(hits[i].name, type);
 }
 
 /**
- * Selects the building elements of \c type from \c node in the given circle by
- * calling circleSelect() for each element.
- * \c node has to be an inherited from Drawable, so it gets a valid circleSelect()
- * \param node      The an object inherited from Drawable which gets searched
- *                  for its primitives.
+ * Selects the vertices of the mesh in the given circle by calling
+ * circleSelect() for each vertex in the square around the circle.
+ * \param mesh      The mesh which gets searched for its primitives.
  * \param type      Type of primitive which are searched.
  * \param center    \e Coordinates of the searching circle's center.
  * \param radius    Radius of the searching circle.
  * \sa doSelect()
  */
-void Selection::doCircleSelect(Drawable *node, unsigned type,
+void Selection::doCircleSelect(Mesh *mesh, unsigned type,
                                const Vector2D& center, int radius)
 {
-    int x0 = center.x - radius;
-    int y0 = center.y - radius;
-    int x1 = center.x + radius;
-    int y1 = center.y + radius;
-
-    GLint hits;
-
-    // start selection mode
-    glSelectBuffer(BUFSIZE, selectBuffer);
-    (void)glRenderMode(GL_SELECT);
-
-    // clear the name stack, push initial name on it
-    glInitNames();
-    glPushName(0);
-
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
+    updateGrid(mesh);
 
     /* No mirroring is required here as coordinates come from the bone structure
      * (bone.getViewCenter), which has its coordinates in the opengl coordinate
      * system, not in the window coordinate system. */
-    glOrtho(x0, x1, y0, y1, -1, 1);
-
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    node->draw(RENDER_TEXTURE | RENDER_WIREFRAME);
-
-    // restore the projection matrix
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix();
-    glFlush();
-
-    // go back to render mode, and process selection buffer
-    hits = glRenderMode(GL_RENDER);
-
-    GLuint *ptr = (GLuint*)selectBuffer;
-
-    for (GLint i = 0; i < hits; i++) {
-        GLuint names = *ptr;
-        ptr += 3;
-        if (names == 2 && *ptr == type) {
-            ptr++;
-            node->circleSelect(*ptr, type, center, radius);
-            ptr++;
-        }
-        else {
-            ptr += names;
-        }
-    }
-}
+    vector<SelectItem> hits;
+    meshGrid.query(center - radius, center + radius,
+                   getDisplayedTypes() & (1 << type), &hits);
 
-int Selection::processFeedback(int size, float buffer[], float points[])
-{
-    int count = size;
-    int index = 0;
-    int passthrough = 0;
-
-    while (count) {
-        GLfloat token = buffer[size - count];
-        count--;
-
-        if (token == GL_PASS_THROUGH_TOKEN) {
-            /* If the actual passthrough token comes directly after the previous
-             * passthrough token then the primitive after the previous
-             * passthrough is out of screen */
-            if (passthrough == 1) {
-                points[index++] = OUT_OF_SCREEN;
-                points[index++] = OUT_OF_SCREEN;
-            }
-
-            points[index++] = buffer[size - count];
-            passthrough = 1;
-            count--;
-        }
-        else if (token == GL_POINT_TOKEN) {
-            for (int i = 0; i < 2; i++) {
-                points[index++] = buffer[size - count];
-                count--;
-            }
-            passthrough = 0;
-        }
-
-        // others should not come
-        else if (token == GL_LINE_TOKEN) {
-            for (int n = 0; n < 2; n++) {
-                for (int i = 0; i < 2; i++) {
-                    count--;
-                }
-            }
-            assert(false);
-        }
-        else if (token == GL_LINE_RESET_TOKEN) {
-            for (int n = 0; n < 2; n++) {
-                for (int i = 0; i < 2; i++) {
-                    count--;
-                }
-            }
-            assert(false);
-        }
-        else if (token == GL_POLYGON_TOKEN) {
-            int n = (int)buffer[size - count];
-            count--;
-            for (; n > 0; n--) {
-                for (int i = 0; i < 2; i++) {
-                    count--;
-                }
-            }
-            assert(false);
-        }
-        else {
-            assert(false);
-        }
-    }
-
-    // check if the last primitive is also out of screen
-    if (passthrough == 1) {
-        points[index++] = OUT_OF_SCREEN;
-        points[index++] = OUT_OF_SCREEN;
-    }
-
-    return index;
-}
-
-/**
- * Draws the given layer in \c GL_FEEDBACK mode, and sets the view coordinates
- * of every primitive to the result of the feedback.
- * Drawing the mesh and skeleton in \c GL_FEEDBACK mode, result in drawing only
- * an individual vertex to the vertices and joints.
- * This position is then used for the particular primitive's view coordinate.
- * All of this is required to let primitive's size view-distance independent.
- *
- * \param layer The layer with a mesh and skeleton which view coordinates get
- *              computed.
- * \sa Mesh::setVertexViewCoords(), Skeleton::setJointViewCoords()
- */
-void Selection::doFeedback(Layer *layer)
-{
-    int size, count;
-
-    /* If points array is to small to hold points found in feedback mode,
-     * allocate new array with double size. Every point requires 3 value in the
-     * array */
-    if (pointsLength < layer->getMesh()->getVertices()->size() * 3) {
-        pointsLength *= 2;
-        delete [] points;
-        points = new float[pointsLength];
-    }
-
-    if (pointsLength < layer->getSkeleton()->getJoints()->size() * 3) {
-        pointsLength *= 2;
-        delete [] points;
-        points = new float[pointsLength];
-    }
-
-    // go to feedback mode
-    glFeedbackBuffer(BUFSIZE, GL_2D, feedBuffer);
-    glRenderMode(GL_FEEDBACK);
-
-    // draw mesh in feedback mode
-    layer->getMesh()->draw(RENDER_FEEDBACK);
-    size = glRenderMode(GL_RENDER);
-
-    // process the feedback buffer and set the vertex positions
-    count = processFeedback(size, feedBuffer, points);
-    layer->getMesh()->setVertexViewCoords(points, count);
-
-    // go to feedback mode
-    glFeedbackBuffer(BUFSIZE, GL_2D, feedBuffer);
-    glRenderMode(GL_FEEDBACK);
-
-    // draw skeleton in feedback mode
-    layer->getSkeleton()->draw(RENDER_FEEDBACK);
-    size = glRenderMode(GL_RENDER);
-
-    // process the feedback buffer and set the joint positions
-    count = processFeedback(size, feedBuffer, points);
-    layer->getSkeleton()->setJointViewCoords(points, count);
+    for (unsigned i = 0; i < hits.size(); i++)
+        mesh->circleSelect(hits[i].name, type, center, radius);
 }
 
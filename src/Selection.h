@@ -24,67 +24,43 @@
 #ifndef __SELECTION_H__
 #define __SELECTION_H__
 
-#if defined(__APPLE__)
-    #include <OPENGL/gl.h>
-    #include <OPENGL/glu.h>
-#else
-    #include <GL/gl.h>
-    #include <GL/glu.h>
-#endif
+#include <vector>
 
 #include "animata.h"
 #include "Camera.h"
 #include "Layer.h"
-#include "TextureManager.h"
+#include "PickGrid.h"
 
 using namespace std;
 
 namespace Animata
 {
 
-/// Describes a picked primitive under the mouse cursor with its type and name.
-struct SelectItem
-{
-    unsigned int type;    ///< type of the selected primitive
-    unsigned int name;    ///< name of the selected primitive
-};
-
 /**
- * Uses various alternative OpenGL rendermodes to implement basic picking,
- * selection and feedback mechanisms.
+ * Implements picking and selection of the primitives under the mouse cursor
+ * or in a selection range.
  * Has an own \a selected buffer to store which objects are found on a 2d
  * coordinate or range during a pick or selection call.
+ *
+ * The primitives are searched in PickGrid by the view coordinates they are
+ * drawn at in the editor, instead of drawing them in OpenGL selection mode.
  */
 class Selection
 {
     ///< searching radius used during picking to find out what's under the mouse cursor
     static const int radius = 5;
 
-    ///< default length of \a selected array
-    static const int MAXHIT_INIT = 8;
-
-    SelectItem *selected;       ///< list of the various primitives under mouse cursor
-    unsigned selectedLength;    ///< actual lenght of the \a selected array
-
-    ///< number of primitives under the mouse cursor after doPick()
-    unsigned hitCount;
-
-    ///< holds vertices' position after calling doFeedback(), every vertex stores three value: name, x, y coordinate
-    float *points;
-    unsigned pointsLength;  ///< actual length of the \a points array
+    vector<SelectItem> selected;    ///< primitives under mouse cursor
 
     Layer *pickLayer;       ///< layer where on the picking happens
 
-    ///< size of the OpenGL buffer during selection and feedback modes
-    static const int BUFSIZE = 65536;
+    PickGrid meshGrid;      ///< faces and vertices of the last searched mesh
+    PickGrid skeletonGrid;  ///< bones and joints of the last searched skeleton
 
-    GLuint *selectBuffer;   ///< internal selection buffer for OpenGL
-    float *feedBuffer;      ///< internal feedback buffer for OpenGL
+    void updateGrid(Mesh *mesh);
+    void updateGrid(Skeleton *skeleton);
 
-    /// Processes selection buffer.
-    void processHits(unsigned hits, GLuint buffer[]);
-    /// Processes feedback buffer.
-    int processFeedback(int size, float buffer[], float points[]);
+    unsigned getDisplayedTypes(void);
 
 public:
 
@@ -99,22 +75,18 @@ public:
         SELECT_TEXTURE
     };
 
-    ///< value for coordinates that are out of screen
-    static const int OUT_OF_SCREEN = 0xABCD;
-
     Selection();
     ~Selection();
 
-    void doPick(Camera *camera, Layer *layer, TextureManager *textureManager,
-                const Vector2D& center);
+    void doPick(Camera *camera, Layer *layer, const Vector2D& center);
 
-    void doSelect(Drawable *node, unsigned type, const Vector2D& pos,
+    void doSelect(Mesh *mesh, unsigned type, const Vector2D& pos,
                   const Vector2D& dim);
-    void doCircleSelect(Drawable *node, unsigned type, const Vector2D& center,
+    void doSelect(Skeleton *skeleton, unsigned type, const Vector2D& pos,
+                  const Vector2D& dim);
+    void doCircleSelect(Mesh *mesh, unsigned type, const Vector2D& center,
                         int radius);
 
-    void doFeedback(Layer *layer);
-
     /**
      * Returns the \a selected array, which holds the primitives that are under
      * the mouse cursor.
@@ -122,16 +94,17 @@ public:
      * Get the size of the array by calling getHitCount().
      * \retval SelectItem* A pointer to the first element of \a selected array.
      */
-    inline SelectItem* getSelected(void) { return selected; }
+    inline SelectItem* getSelected(void)
+        { return selected.empty() ? NULL : &selected[0]; }
     /**
      * Returns the number of primitives under the mouse cursor after calling doPick().
      * \retval int The number of the picked primitives.
      */
-    inline int getHitCount(void) { return hitCount; }
+    inline int getHitCount(void) { return selected.size(); }
     /**
      * Virtually clears the \a selected array by setting the size of it to 0.
      */
-    inline void clearSelection(void) { hitCount = 0; }
+    inline void clearSelection(void) { selected.clear(); }
 
     /**
      * Returns the Layer which was the argument for the last doPick() call.
@@ -145,7 +118,12 @@ public:
     /**
      * Invalidates pick layer, necessary when loading or starting a new file.
      */
-    inline void cancelPickLayer() { pickLayer = NULL; }
+    inline void cancelPickLayer()
+    {
+        pickLayer = NULL;
+        meshGrid.invalidate();
+        skeletonGrid.invalidate();
+    }
 };
 
 } /* namespace Animata */
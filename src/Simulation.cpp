@@ -0,0 +1,113 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "animata.h"
+#include "animataUI.h"
+#include "Simulation.h"
+
+using namespace Animata;
+
+Simulation::Simulation()
+{
+    thread = 0;
+    threadRunning = false;
+    pool = new ThreadPool();
+}
+
+Simulation::~Simulation()
+{
+    stop();
+    delete pool;
+}
+
+void *Simulation::threadFunc(void *p)
+{
+    static_cast<Simulation *>(p)->threadTask();
+    return 0;
+}
+
+void Simulation::start(void)
+{
+    if (thread == 0) {
+        threadRunning = true;
+        pthread_create(&thread, NULL, &threadFunc, this);
+    }
+}
+
+void Simulation::stop(void)
+{
+    if (thread) {
+        threadRunning = false;
+        pthread_join(thread, NULL);    // wait until the thread is complete
+        thread = 0;
+    }
+}
+
+/**
+ * Runs one step of the simulation and publishes the resulting poses.
+ **/
+void Simulation::step(void)
+{
+    ui->editorBox->lock();
+
+    Layer *rootLayer = ui->editorBox->getRootLayer();
+    if (rootLayer) {
+        /* run the spring model simulation on all bones of the skeleton */
+        if (ui->settings.playSimulation == 1)
+            rootLayer->simulate(ui->settings.iteration, pool);
+
+        /* the windows are only drawn again if the poses have changed */
+        if (rootLayer->publishPose())
+            ui->editorBox->invalidateFrame();
+    }
+
+    ui->editorBox->unlock();
+}
+
+void Simulation::threadTask(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    double next = tv.tv_sec + tv.tv_usec * 1e-6;
+
+    while (threadRunning && (ui != NULL)) {
+        step();
+
+        int rate = ui->settings.simulationRate;
+        next += 1.0 / ((rate > 0) ? rate : 1);
+
+        gettimeofday(&tv, NULL);
+        double now = tv.tv_sec + tv.tv_usec * 1e-6;
+        if (next > now) {
+            usleep((useconds_t)((next - now) * 1e6));
+        }
+        else {
+            /* running late, don't try to catch up with the lost steps */
+            next = now;
+        }
+    }
+}
+
@@ -0,0 +1,72 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __SIMULATION_H__
+#define __SIMULATION_H__
+
+#include <pthread.h>
+
+#include "ThreadPool.h"
+
+namespace Animata
+{
+
+/// Runs the simulation of the scene on its own thread at a fixed rate.
+/**
+ * Every step simulates the layers while holding the editor lock, then
+ * publishes the vertex and joint positions to the pose buffers of the
+ * meshes and skeletons, from where the windows draw them.
+ **/
+class Simulation
+{
+private:
+
+    /// Helper function to call class method threadTask() from a thread.
+    static void *threadFunc(void *p);
+
+    /// Threads function running the simulation until stopped.
+    void threadTask(void);
+
+    void step(void);
+
+    pthread_t thread;
+
+    bool threadRunning; //< true if the thread is running
+
+    ThreadPool *pool;   ///< runs skeleton simulations in parallel
+
+public:
+
+    Simulation();
+    ~Simulation();
+
+    /// Starts the simulation in a new thread.
+    void start(void);
+    /// Stops the simulation.
+    void stop(void);
+};
+
+} /* namespace Animata */
+
+#endif
+
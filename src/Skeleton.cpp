@@ -22,12 +22,18 @@
 */
 
 #include <stdio.h>
+#include <math.h>
+#include <map>
 
+#include "Context.h"
+#include "Skeleton.h"
+
+#ifndef ANIMATA_HEADLESS
 #include "animata.h"
 #include "animataUI.h"
 #include "Primitives.h"
-#include "Skeleton.h"
 #include "Transform.h"
+#endif
 
 using namespace Animata;
 
@@ -41,6 +47,25 @@ Skeleton::Skeleton()
 
     bones = new vector<Bone *>;
     pBone = NULL;
+
+    solver = new SkeletonSolver();
+    solverDirty = true;
+    iterationCount = 0;
+    skinPasses = 1;
+
+    skin = new SkinTable();
+    skinDirty = true;
+    revision = 0;
+#ifndef ANIMATA_HEADLESS
+    viewRevision = 0;
+#endif
+    skinDeferred = false;
+    skinStale = false;
+    skinDeferRequest = false;
+    pthread_mutex_init(&skinMutex, NULL);
+
+    asleep = false;
+    gravity = 0;
 }
 
 /**
@@ -63,6 +88,11 @@ Skeleton::~Skeleton()
         bones->clear(); /* clear all vector elements */
         delete bones;
     }
+
+    delete solver;
+    delete skin;
+
+    pthread_mutex_destroy(&skinMutex);
 }
 
 /**
@@ -74,10 +104,10 @@ Joint *Skeleton::addJoint(const Vector2D& pos)
 {
     Joint *j = new Joint(pos);
     joints->push_back(j);
+    solverDirty = true;
 
     /* add to vector of all joints */
-    if (ui) // FIXME: ui should not be NULL!
-        ui->editorBox->addToAllJoints(j);
+    context->addToAllJoints(j);
     return j;
 }
 
@@ -104,10 +134,12 @@ Bone *Skeleton::addBone(Joint *j0, Joint *j1)
     /* make a new bone */
     Bone *b = new Bone(j0, j1);
     bones->push_back(b);
+    solverDirty = true;
+    skinDirty = true;
+    revision++;
 
     /* add to vector of all bones */
-    if (ui) // FIXME: ui should not be NULL!
-        ui->editorBox->addToAllBones(b);
+    context->addToAllBones(b);
     return b;
 }
 
@@ -206,10 +238,10 @@ void Skeleton::setSelectedJointParameters(enum ANIMATA_PREFERENCES prefParam,
                     // add or remove the joint from the vector of joints
                     // needed to be sent via OSC
                     if (osc) {
-                        ui->editorBox->addToOSCJoints(j);
+                        context->addToOSCJoints(j);
                     }
                     else {
-                        ui->editorBox->deleteFromOSCJoints(j);
+                        context->deleteFromOSCJoints(j);
                     }
                     break;
                 }
@@ -248,6 +280,8 @@ void Skeleton::setSelectedBoneParameters(const char *str, float s, float lm,
                 // FIXME: should be calculated when the attach
                 // button is pressed
                 b->recalculateWeights();
+                skinDirty = true;
+                revision++;
             }
         }
     }
@@ -295,6 +329,7 @@ void Skeleton::setSelectedBoneTempo(float p)
     }
 }
 
+#ifndef ANIMATA_HEADLESS
 /**
  * Deletes the selected joint.
  **/
@@ -331,10 +366,12 @@ void Skeleton::deleteSelectedJoint(void)
     /* delete the joint */
     vector<Joint *>::iterator iter = joints->begin() + selected->name;
     /* delete the joint from vector of all joints */
-    if (ui) // FIXME: ui should not be NULL
-        ui->editorBox->deleteFromAllJoints(*iter);
+    context->deleteFromAllJoints(*iter);
     delete *iter; /* delete object */
     joints->erase(iter); /* remove it from the vector */
+    solverDirty = true;
+    skinDirty = true;
+    revision++;
     /* current selection points to the next joint after the deleted one */
     selector->clearSelection();
 }
@@ -363,14 +400,17 @@ void Skeleton::deleteSelectedBone(void)
     /* delete the bone and references to it*/
     vector<Bone *>::iterator iter = bones->begin() + selected->name;
     /* delete the bone from vector of all bones */
-    if (ui) // FIXME: ui should not be NULL
-        ui->editorBox->deleteFromAllBones(*iter);
+    context->deleteFromAllBones(*iter);
     delete *iter; /* delete object */
     bones->erase(iter); /* remove it from the vector */
+    solverDirty = true;
+    skinDirty = true;
+    revision++;
     /* clear selection, because it contains a non-existing object */
     selector->clearSelection();
 
 }
+#endif
 
 /**
  * Clears the selection of bones and joints.
@@ -406,9 +446,13 @@ void Skeleton::attachVertices(vector<Vertex *> *verts)
     if (s == 1) {
         selectedBone->attachVertices(verts);
         delete verts;
+        skinDirty = true;
+        revision++;
+        wake();
     }
 }
 
+#ifndef ANIMATA_HEADLESS
 /**
  * Select vertices in bone range
  * if there are no attached vertices use circle selection
@@ -440,6 +484,7 @@ void Skeleton::selectVerticesInRange(Mesh *mesh)
         }
     }
 }
+#endif
 
 /**
  * Detaches vertices from bone.
@@ -453,6 +498,8 @@ void Skeleton::detachVertices(void)
             b->detachVertices();
         }
     }
+    skinDirty = true;
+    revision++;
 }
 
 /**
@@ -467,37 +514,212 @@ void Skeleton::detachSelectedVertex(Vertex *v)
     for (unsigned i = 0; i < bones->size(); i++) {
         (*bones)[i]->detachVertex(v);
     }
+    skinDirty = true;
+    revision++;
+}
+
+#ifndef ANIMATA_HEADLESS
+/**
+ * Projects the drawn positions of the joints of this skeleton to the screen
+ * with Transform::projectPoints(). Setting the transformation matrices by
+ * Transform::setMatrices() is neccesary before calling this.
+ * \param coords    Array of at least two elements per joint, receiving the
+ *                  x and y view coordinates.
+ **/
+void Skeleton::projectJoints(float *coords)
+{
+    unsigned count = joints->size();
+    for (unsigned i = 0; i < count; i++) {
+        const Vector2D& position = getPosePosition(i);
+        coords[i * 2] = position.x;
+        coords[i * 2 + 1] = position.y;
+    }
+
+    Transform::projectPoints(coords, count);
 }
 
 /**
- * Sets the view coordinates of the joints of this skeleton.
- * Setting the transformation matrices by Transform::setMatrices() is neccesary
- * before calling this,
- * because Transform::project() is used for non visible primitives.
+ * Sets the view coordinates of the joints of this skeleton, which are used
+ * for editing the skeleton and drawing it.
+ * \param coords    x and y view coordinates of every joint as computed by
+ *                  projectJoints()
  **/
-void Skeleton::setJointViewCoords(float *coords, unsigned int size)
+void Skeleton::setJointViewCoords(const float *coords)
 {
-    for (unsigned i = 0; i < size; i+=3) {
-        unsigned n = (unsigned)coords[i];
-        Joint *j = (*joints)[n];
+    bool changed = false;
+    unsigned count = joints->size();
+    for (unsigned i = 0; i < count; i++) {
+        Joint *j = (*joints)[i];
+        if ((j->viewPosition.x != coords[i * 2]) ||
+            (j->viewPosition.y != coords[i * 2 + 1])) {
+            j->viewPosition.x = coords[i * 2];
+            j->viewPosition.y = coords[i * 2 + 1];
+            changed = true;
+        }
+    }
+
+    if (changed)
+        viewRevision++;
+}
+#endif
+
+/**
+ * Leaves the skinning of the attached vertices to the drawing code, or
+ * takes it back. Vertices are moved to the drawn pose when taken back.
+ * Called by the drawing thread, the request is taken over by the next
+ * simulation step.
+ * \param d true to skip skinning in the simulation
+ **/
+void Skeleton::deferSkinning(bool d)
+{
+    pthread_mutex_lock(&skinMutex);
+    skinDeferRequest = d;
+    pthread_mutex_unlock(&skinMutex);
+}
+
+/**
+ * Checks whether the attached vertices lag behind the drawn pose, called by
+ * the drawing thread.
+ * \return true if the vertices were not skinned since skinning was deferred
+ **/
+bool Skeleton::isSkinStale(void)
+{
+    pthread_mutex_lock(&skinMutex);
+    bool stale = skinStale;
+    pthread_mutex_unlock(&skinMutex);
+
+    return stale;
+}
+
+/**
+ * Switches to the skinning mode requested by deferSkinning(), and wakes the
+ * skeleton if it has changed. Called by the simulation thread.
+ **/
+void Skeleton::takeSkinningRequest(void)
+{
+    pthread_mutex_lock(&skinMutex);
+    bool d = skinDeferRequest;
+    pthread_mutex_unlock(&skinMutex);
+
+    if (d != skinDeferred) {
+        skinDeferred = d;
+        asleep = false;
+    }
+}
 
-        // joint is out of screen lets do projection here
-        if (i + 1 < size && coords[i + 1] == Selection::OUT_OF_SCREEN) {
-            Vector3D view = Transform::project(j->position);
+/**
+ * Sets whether the attached vertices lag behind the drawn pose.
+ * \param s true if the vertices were not skinned
+ **/
+void Skeleton::setSkinStale(bool s)
+{
+    pthread_mutex_lock(&skinMutex);
+    skinStale = s;
+    pthread_mutex_unlock(&skinMutex);
+}
 
-            j->viewPosition.x = view.x;
-            j->viewPosition.y = view.y;
+/**
+ * Copies the joint positions to the pose buffer and publishes them for
+ * drawing. Called by the simulation thread.
+ * \return true if the positions have changed since the last time
+ **/
+bool Skeleton::publishPose(void)
+{
+    takeSkinningRequest();
+
+    /* the attached vertices lag behind since their skinning was deferred,
+     * move them to the pose they were drawn in */
+    if (skinStale && !skinDeferred) {
+        /* the changes taken over here are not seen again by simulate(), so
+         * joints moved or bones edited while the simulation is paused have
+         * to wake the skeleton */
+        if (gatherSolver())
+            asleep = false;
+        if (skinDirty) {
+            skin->build(bones);
+            skinDirty = false;
+            asleep = false;
         }
-        else {
-            j->viewPosition.x = coords[i + 1];
-            j->viewPosition.y = coords[i + 2];
+        skin->skin(solver, skinPasses, true);
+        setSkinStale(false);
+    }
+
+    vector<Vector2D> *p = pose.getBack();
+    unsigned count = joints->size();
+
+    p->resize(count);
+    for (unsigned i = 0; i < count; i++)
+        (*p)[i] = (*joints)[i]->position;
+
+    return pose.publish(revision);
+}
+
+/**
+ * Returns the position of a joint in the latched pose. Joints added since the
+ * last published pose are at their current position, and so are all of them
+ * if joints were removed since then, until the next pose is latched.
+ * \param i index of the joint
+ * \return position of the joint
+ **/
+const Vector2D& Skeleton::getPosePosition(unsigned i)
+{
+    const vector<Vector2D> *p = pose.getFront();
+    if ((pose.getFrontRevision() == revision) && (i < p->size()))
+        return (*p)[i];
+    else
+        return (*joints)[i]->position;
+}
+
+/**
+ * Gets the bounding box of the joints in the latched pose. If the attached
+ * vertices lag behind the pose, as they are skinned when drawn, the box is
+ * enlarged by the farthest distance a vertex was attached from the centre
+ * of its bone, so it holds the drawn vertices as well.
+ * \param min   receives the lower corner of the box
+ * \param max   receives the upper corner of the box
+ * \return false if the skeleton has no joints
+ **/
+bool Skeleton::getPoseBounds(Vector2D *min, Vector2D *max)
+{
+    unsigned count = joints->size();
+    if (count == 0)
+        return false;
+
+    *min = *max = getPosePosition(0);
+    for (unsigned i = 1; i < count; i++) {
+        const Vector2D& p = getPosePosition(i);
+        if (p.x < min->x)
+            min->x = p.x;
+        else if (p.x > max->x)
+            max->x = p.x;
+        if (p.y < min->y)
+            min->y = p.y;
+        else if (p.y > max->y)
+            max->y = p.y;
+    }
+
+    if (isSkinStale()) {
+        float reach = 0;
+        for (unsigned i = 0; i < bones->size(); i++) {
+            float *dsts, *weights, *ca, *sa;
+            vector<Vertex *> *verts =
+                (*bones)[i]->getAttachedVertices(&dsts, &weights, &ca, &sa);
+            for (unsigned j = 0; j < verts->size(); j++) {
+                if (dsts[j] > reach)
+                    reach = dsts[j];
+            }
         }
+        *min -= reach;
+        *max += reach;
     }
+
+    return true;
 }
 
+#ifndef ANIMATA_HEADLESS
 /**
  * Draws the skeleton.
- * \param mode  bitmask of RENDER_WIREFRAME, RENDER_FEEDBACK or RENDER_OUTPUT,
+ * \param mode  bitmask of RENDER_WIREFRAME or RENDER_OUTPUT,
  *              determines how the primitives are drawn.
  * \param active active state
  **/
@@ -540,54 +762,95 @@ void Skeleton::draw(int mode, int active)
             || ((mode & RENDER_OUTPUT)
                 && ui->settings.display_elements & DISPLAY_OUTPUT_BONE)))
     {
-        glLoadName(Selection::SELECT_BONE);    /* type of primitive */
-        glPushName(0);                        /* id of primitive */
-
         for (unsigned i = 0; i < bones->size(); i++) {
             Bone *bone = (*bones)[i];
 
-            glLoadName(i);
-
             if (mode & RENDER_OUTPUT)
                 bone->draw(false);
             else
                 bone->draw(bone == pBone, active);
         }
-
-        glPopName();
     }
 
-    if (mode & RENDER_FEEDBACK) {
-        for (unsigned i = 0; i < joints->size(); i++) {
-            Joint *joint = (*joints)[i];
-
-            glPassThrough(i);
-            glBegin(GL_POINTS);
-                glVertex2f(joint->position.x, joint->position.y);
-            glEnd();
-        }
-    }
-    else if ((mode & RENDER_WIREFRAME) &&
+    if ((mode & RENDER_WIREFRAME) &&
              ((!(mode & RENDER_OUTPUT)
                && ui->settings.display_elements & DISPLAY_EDITOR_JOINT) ||
              ((mode & RENDER_OUTPUT)
               && ui->settings.display_elements & DISPLAY_OUTPUT_JOINT)))
     {
-        glLoadName(Selection::SELECT_JOINT);    /* type of primitive */
-        glPushName(0);                            /* id of primitive */
-
         for (unsigned i = 0; i < joints->size(); i++) {
             Joint *joint = (*joints)[i];
 
-            glLoadName(i);
-
             if (mode & RENDER_OUTPUT)
                 joint->draw(false);
             else
                 joint->draw(joint == pJoint, active);
         }
+    }
+}
+
+/**
+ * Draws the skeleton in the output window from view coordinates kept outside
+ * the joints and vertices, based on the actual
+ * AnimataSettings::display_elements.
+ * \param points        x and y view coordinates of every joint
+ * \param vertices      vertices of the mesh of the layer
+ * \param vertexPoints  x and y view coordinates of the vertices, or NULL if
+ *                      they are not known
+ * \sa DrawList::drawWireframe()
+ **/
+void Skeleton::drawWireframe(const float *points, vector<Vertex *> *vertices,
+                             const float *vertexPoints)
+{
+    if (ui->settings.display_elements & DISPLAY_OUTPUT_BONE) {
+        map<Joint *, unsigned> index;
+        for (unsigned i = 0; i < joints->size(); i++)
+            index[(*joints)[i]] = i * 2;
+
+        map<Vertex *, unsigned> vertexIndex;
+        if (vertexPoints &&
+            (ui->settings.mode == ANIMATA_MODE_ATTACH_VERTICES)) {
+            for (unsigned i = 0; i < vertices->size(); i++)
+                vertexIndex[(*vertices)[i]] = i * 2;
+        }
 
-        glPopName();
+        for (unsigned i = 0; i < bones->size(); i++) {
+            Bone *bone = (*bones)[i];
+            const float *c0 = points + index[bone->j0];
+            const float *c1 = points + index[bone->j1];
+            Vector2D p0(c0[0], c0[1]);
+            Vector2D p1(c1[0], c1[1]);
+
+            Primitives::drawBone(bone, p0, p1, false, 1);
+
+            /* the circle and the vertices of the bone being attached */
+            if (vertexIndex.empty() || !bone->selected)
+                continue;
+
+            Vector2D d(p1 - p0);
+            int r = (int)(d.size() * 0.5f * bone->getRadiusMult());
+            Primitives::drawSelectionCircle((p0 + p1) * 0.5f, r);
+
+            float *dsts, *weights, *ca, *sa;
+            vector<Vertex *> *attached =
+                bone->getAttachedVertices(&dsts, &weights, &ca, &sa);
+            for (unsigned j = 0; j < attached->size(); j++) {
+                map<Vertex *, unsigned>::iterator v =
+                    vertexIndex.find((*attached)[j]);
+                if (v == vertexIndex.end())
+                    continue;
+
+                const float *p = vertexPoints + v->second;
+                Primitives::drawVertexAttached(Vector2D(p[0], p[1]));
+            }
+        }
+    }
+
+    if (ui->settings.display_elements & DISPLAY_OUTPUT_JOINT) {
+        for (unsigned i = 0; i < joints->size(); i++) {
+            Vector2D p(points[i * 2], points[i * 2 + 1]);
+            Primitives::drawJoint((*joints)[i], p, false, 1);
+        }
     }
 }
 
@@ -614,21 +877,169 @@ void Skeleton::circleSelect(unsigned i, int type, const Vector2D& center,
                             float r)
 {
 }
+#endif
 
 /**
- * Runs the simulation on joints and bones
- * \param times number of times to run the simulation
+ * Copies the state of joints and bones to the solver. The joint indices of
+ * the bones are only looked up again if the skeleton has been changed.
+ * \return true if anything differs from the state the solver left behind,
+ *         meaning the skeleton was moved or edited from outside
  **/
-void Skeleton::simulate(int times /* = 1 */)
+bool Skeleton::gatherSolver(void)
 {
-    for (int t = 0; t < times; t++) {
-        for (unsigned i = 0; i < joints->size(); i++) {
-            ((*joints)[i])->simulate();
+    unsigned jointCount = joints->size();
+    unsigned boneCount = bones->size();
+    bool changed = false;
+
+    if (solverDirty) {
+        map<Joint *, unsigned> index;
+
+        solver->clear();
+        for (unsigned i = 0; i < jointCount; i++) {
+            Joint *j = (*joints)[i];
+            index[j] = solver->addJoint(j->position);
         }
-        for (unsigned i = 0; i < bones->size(); i++) {
-            ((*bones)[i])->simulate();
-            ((*bones)[i])->translateVertices();
+        for (unsigned i = 0; i < boneCount; i++) {
+            Bone *b = (*bones)[i];
+            solver->addBone(index[b->j0], index[b->j1], b->getOrigSize());
+        }
+        solverDirty = false;
+        changed = true;
+    }
+
+    for (unsigned i = 0; i < jointCount; i++) {
+        Joint *j = (*joints)[i];
+        unsigned char pinned = j->fixed || j->dragged;
+        if ((fabs(solver->x[i] - j->position.x) > SKELETON_SLEEP_EPSILON) ||
+            (fabs(solver->y[i] - j->position.y) > SKELETON_SLEEP_EPSILON) ||
+            (solver->pinned[i] != pinned))
+            changed = true;
+
+        solver->x[i] = j->position.x;
+        solver->y[i] = j->position.y;
+        solver->pinned[i] = pinned;
+    }
+
+    for (unsigned i = 0; i < boneCount; i++) {
+        Bone *b = (*bones)[i];
+        if ((solver->length[i] != b->getOrigSize()) ||
+            (solver->damp[i] != b->damp) ||
+            (solver->lengthMult[i] != b->getLengthMult()) ||
+            (solver->tempo[i] != b->getTempo()))
+            changed = true;
+
+        solver->length[i] = b->getOrigSize();
+        solver->damp[i] = b->damp;
+        solver->lengthMult[i] = b->getLengthMult();
+        solver->lengthMultMin[i] = b->getLengthMultMin();
+        solver->lengthMultMax[i] = b->getLengthMultMax();
+        solver->tempo[i] = b->getTempo();
+        solver->time[i] = b->getTime();
+    }
+
+    return changed;
+}
+
+/**
+ * Copies the simulated joint positions and bone oscillator states back from
+ * the solver.
+ **/
+void Skeleton::scatterSolver(void)
+{
+    for (unsigned i = 0; i < joints->size(); i++) {
+        Joint *j = (*joints)[i];
+        j->position.x = solver->x[i];
+        j->position.y = solver->y[i];
+    }
+
+    for (unsigned i = 0; i < bones->size(); i++) {
+        if (solver->tempo[i] > 0) {
+            (*bones)[i]->setAnimationState(solver->time[i],
+                                           solver->lengthMult[i]);
         }
     }
 }
 
+/**
+ * Runs the simulation on joints and bones.
+ * If a convergence tolerance is set in the settings, the simulation stops
+ * as soon as no bone differs from its rest length by more than the tolerance.
+ * A skeleton without oscillating bones falls asleep once neither its joints
+ * nor its attached vertices move any more, and it is skipped until
+ * something changes it from outside.
+ * \param times maximum number of times to run the simulation
+ **/
+void Skeleton::simulate(int times /* = 1 */)
+{
+    AnimataSettings *settings = context->getSettings();
+
+    float g = 0;
+    if (settings->gravity == 1)
+        g = settings->gravityForce;
+    float tolerance = settings->tolerance;
+
+    takeSkinningRequest();
+
+    if (skinDirty) {
+        skin->build(bones);
+        skinDirty = false;
+        asleep = false;
+    }
+
+    if (gatherSolver() || (g != gravity)) {
+        asleep = false;
+        gravity = g;
+    }
+
+    if (asleep) {
+        iterationCount = 0;
+        return;
+    }
+
+    solver->setRelaxation(settings->relaxation);
+
+    int t = 0;
+    while (t < times) {
+        float residual = solver->relax(gravity);
+        t++;
+
+        if ((tolerance > 0) && (residual < tolerance))
+            break;
+    }
+
+    /* keep the tempo of the oscillators independent of the convergence */
+    if (t < times)
+        solver->animateBones(times - t);
+
+    iterationCount = t;
+    skinPasses = settings->convergedSkinning ? t : 1;
+
+    /* move the attached vertices once to the final pose, in converged mode
+     * as far as the passes run would have pulled them, unless they are
+     * skinned when drawn */
+    float maxMove = 0;
+    if (skinDeferred) {
+        setSkinStale(true);
+    }
+    else {
+        maxMove = skin->skin(solver, skinPasses, skinStale);
+        setSkinStale(false);
+    }
+
+    /* the joint positions still hold the state from before the simulation,
+     * the skeleton is at rest if nothing has moved since */
+    bool resting = (maxMove <= SKELETON_SLEEP_EPSILON * SKELETON_SLEEP_EPSILON);
+    for (unsigned i = 0; resting && (i < bones->size()); i++) {
+        if (solver->tempo[i] > 0)
+            resting = false;
+    }
+    for (unsigned i = 0; resting && (i < joints->size()); i++) {
+        Joint *j = (*joints)[i];
+        if ((fabs(solver->x[i] - j->position.x) > SKELETON_SLEEP_EPSILON) ||
+            (fabs(solver->y[i] - j->position.y) > SKELETON_SLEEP_EPSILON))
+            resting = false;
+    }
+    asleep = resting;
+
+    scatterSolver();
+}
@@ -25,13 +25,20 @@
 #define __SKELETON_H__
 
 #include <float.h>
+#include <pthread.h>
 #include <vector>
 
 #include "Vector2D.h"
 #include "Joint.h"
 #include "Bone.h"
+#include "SkeletonSolver.h"
+#include "SkinTable.h"
+#include "PoseBuffer.h"
 #include "Preferences.h"
 
+/** joints and vertices moving less than this are considered at rest */
+#define SKELETON_SLEEP_EPSILON .001f
+
 using namespace std;
 
 namespace Animata
@@ -65,25 +72,69 @@ public:
     void setSelectedBoneLengthMultMax(float p);
     void setSelectedBoneTempo(float p);
 
+#ifndef ANIMATA_HEADLESS
     void deleteSelectedJoint(void);
     void deleteSelectedBone(void);
+#endif
 
     void clearSelection(void);
 
-    void setJointViewCoords(float *coords, unsigned int size);
+#ifndef ANIMATA_HEADLESS
+    void projectJoints(float *coords);
+    void setJointViewCoords(const float *coords);
 
     virtual void draw(int mode, int active = 1);
+    void drawWireframe(const float *points, vector<Vertex *> *vertices,
+                       const float *vertexPoints);
+
     virtual void select(unsigned i, int type);
     virtual void circleSelect(unsigned i, int type, const Vector2D& center,
                               float r);
+#endif
 
     void simulate(int times = 1);
 
+    /// Returns the number of passes the last simulation took.
+    inline int getIterationCount(void) const { return iterationCount; }
+    /**
+     * Returns the number of times the attached vertices are pulled towards
+     * the bones for the last simulated frame, see SkinTable::skin().
+     **/
+    inline int getSkinPasses(void) const { return skinPasses; }
+
+    /// Makes the skeleton simulated again on the next frame.
+    inline void wake(void) { asleep = false; }
+    /// Returns true if the skeleton is at rest and not simulated.
+    inline bool isAsleep(void) const { return asleep; }
+
+    bool publishPose(void);
+    /// Makes the latest published joint positions the ones to be drawn.
+    inline bool latchPose(void) { return pose.latch(); }
+    const Vector2D& getPosePosition(unsigned i);
+    bool getPoseBounds(Vector2D *min, Vector2D *max);
+
+    void deferSkinning(bool d);
+    bool isSkinStale(void);
+    /**
+     * Returns the revision of the skeleton, which changes when joints or
+     * bones are added or removed or vertices are attached or detached.
+     **/
+    inline unsigned getRevision(void) const { return revision; }
+#ifndef ANIMATA_HEADLESS
+    /**
+     * Returns the revision of the view coordinates of the joints, which
+     * changes when they are set to different values.
+     **/
+    inline unsigned getViewRevision(void) const { return viewRevision; }
+#endif
+
     void attachVertices(vector<Vertex *> *verts);
     void detachVertices(void);
     void detachSelectedVertex(Vertex *v);
 
+#ifndef ANIMATA_HEADLESS
     void selectVerticesInRange(Mesh *mesh);
+#endif
 
     /// Returns the joint below the mouse cursor.
     inline Joint *getPointedJoint(void) { return pJoint; }
@@ -103,6 +154,43 @@ private:
 
     Joint *pJoint;  /**< joint below the cursor */
     Bone *pBone;    /**< bone below the cursor */
+
+    SkeletonSolver *solver; /**< packed simulation state */
+    /** set if joints or bones were added or removed since the solver
+     * was built */
+    bool solverDirty;
+    int iterationCount; /**< passes run by the last simulation */
+    /** passes the vertices are pulled for, kept while the skeleton sleeps */
+    int skinPasses;
+
+    SkinTable *skin;    /**< vertex attachments of the bones */
+    /** set if vertices were attached or detached since the skin table was
+     * built */
+    bool skinDirty;
+    unsigned revision;  /**< incremented when the skin table gets dirty */
+#ifndef ANIMATA_HEADLESS
+    /** incremented when the view coordinates of the joints change */
+    unsigned viewRevision;
+#endif
+    /** set if the vertices are skinned when drawn instead of simulated */
+    bool skinDeferred;
+    /** set if the vertices were not skinned since skinning was deferred */
+    bool skinStale;
+    /** skinning mode requested by the drawing code for the next step */
+    bool skinDeferRequest;
+    /** protects \a skinDeferRequest and the writes of \a skinStale, which
+     * are shared with the drawing thread */
+    pthread_mutex_t skinMutex;
+
+    bool asleep;    /**< set if the skeleton came to rest */
+    float gravity;  /**< gravity force used in the last simulation */
+
+    bool gatherSolver(void);
+    void scatterSolver(void);
+    void takeSkinningRequest(void);
+    void setSkinStale(bool s);
+
+    PoseBuffer pose; /**< joint positions published for drawing */
 };
 
 } /* namespace Animata */
@@ -0,0 +1,377 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <math.h>
+#include <float.h>
+#include <limits.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "Bone.h"
+#include "SkeletonSolver.h"
+
+using namespace Animata;
+
+/**
+ * Creates an empty solver.
+ **/
+SkeletonSolver::SkeletonSolver()
+{
+    relaxation = 1;
+    colored = false;
+}
+
+/**
+ * Removes all joints and bones from the solver.
+ **/
+void SkeletonSolver::clear(void)
+{
+    x.clear();
+    y.clear();
+    pinned.clear();
+
+    j0.clear();
+    j1.clear();
+    length.clear();
+    damp.clear();
+    lengthMult.clear();
+    lengthMultMin.clear();
+    lengthMultMax.clear();
+    tempo.clear();
+    time.clear();
+
+    colored = false;
+}
+
+/**
+ * Adds a joint to the solver.
+ * \param p position of the joint
+ * \param pinned true if the simulation should not move the joint
+ * \return index of the new joint
+ **/
+unsigned SkeletonSolver::addJoint(const Vector2D& p, bool pinned /* = false */)
+{
+    x.push_back(p.x);
+    y.push_back(p.y);
+    this->pinned.push_back(pinned);
+    return x.size() - 1;
+}
+
+/**
+ * Adds a bone with default parameters to the solver.
+ * \param j0 index of one joint
+ * \param j1 index of the other joint
+ * \param length original length of the bone
+ * \return index of the new bone
+ **/
+unsigned SkeletonSolver::addBone(unsigned j0, unsigned j1, float length)
+{
+    this->j0.push_back(j0);
+    this->j1.push_back(j1);
+    this->length.push_back(length);
+    damp.push_back(BONE_DEFAULT_DAMP);
+    lengthMult.push_back(BONE_DEFAULT_LENGTH_MULT);
+    lengthMultMin.push_back(BONE_DEFAULT_LENGTH_MULT_MIN);
+    lengthMultMax.push_back(BONE_DEFAULT_LENGTH_MULT_MAX);
+    tempo.push_back(0);
+    time.push_back(M_PI_2);
+    colored = false;
+    return this->j0.size() - 1;
+}
+
+/**
+ * Pulls all joints which are not pinned by the gravity force.
+ * \param force strength of the gravity
+ **/
+void SkeletonSolver::applyGravity(float force)
+{
+    unsigned count = x.size();
+    for (unsigned i = 0; i < count; i++) {
+        if (!pinned[i]) {
+            x[i] += force;
+            y[i] += force;
+        }
+    }
+}
+
+/**
+ * Steps the oscillator of a bone and sets its length multiplier accordingly.
+ * \param b index of the bone
+ * \param passes number of simulation passes to step the oscillator by
+ **/
+void SkeletonSolver::animateBone(unsigned b, int passes /* = 1 */)
+{
+    time[b] += passes * tempo[b] / 42.0f;    // FIXME
+    float t = 0.5f + sin(time[b]) * 0.5f;
+    lengthMult[b] = lengthMultMin[b] +
+                    (lengthMultMax[b] - lengthMultMin[b]) * t;
+}
+
+/**
+ * Steps the oscillators of all animated bones.
+ * \param passes number of simulation passes to step the oscillators by
+ **/
+void SkeletonSolver::animateBones(int passes)
+{
+    unsigned count = j0.size();
+    for (unsigned b = 0; b < count; b++) {
+        if (tempo[b] > 0)
+            animateBone(b, passes);
+    }
+}
+
+/**
+ * Runs the spring simulation on one bone.
+ * \param b index of the bone
+ * \return difference of the bone length from its rest length before the
+ *         correction
+ **/
+float SkeletonSolver::relaxBone(unsigned b)
+{
+    unsigned a = j0[b];
+    unsigned c = j1[b];
+
+    float dx = x[c] - x[a];
+    float dy = y[c] - y[a];
+    float dCurrent = sqrt(dx * dx + dy * dy);
+    if (dCurrent > FLT_EPSILON) {
+        dx /= dCurrent;
+        dy /= dCurrent;
+    }
+
+    float residual = (length[b] * lengthMult[b]) - dCurrent;
+    float m = residual * damp[b] * relaxation;
+
+    dx *= m;
+    dy *= m;
+    if (!pinned[a]) {
+        x[a] -= dx;
+        y[a] -= dy;
+    }
+    if (!pinned[c]) {
+        x[c] += dx;
+        y[c] += dy;
+    }
+
+    return fabs(residual);
+}
+
+/**
+ * Partitions bones into colors greedily in their original order, so that
+ * bones sharing a joint get different colors.
+ **/
+void SkeletonSolver::colorBones(void)
+{
+    if (colored)
+        return;
+
+    unsigned count = j0.size();
+    const unsigned maxColors = sizeof(unsigned) * CHAR_BIT;
+
+    /* bitmask of the colors already used at each joint */
+    vector<unsigned> jointColors(x.size(), 0);
+    vector<unsigned> boneColor(count);
+    vector<unsigned> colorSize;
+
+    for (unsigned b = 0; b < count; b++) {
+        unsigned used = jointColors[j0[b]] | jointColors[j1[b]];
+        unsigned c = 0;
+        while ((c < maxColors - 1) && (used & (1u << c)))
+            c++;
+        /* the last color collects bones of joints with too many bones,
+         * it is relaxed one bone at a time */
+        jointColors[j0[b]] |= 1u << c;
+        jointColors[j1[b]] |= 1u << c;
+        boneColor[b] = c;
+        if (c >= colorSize.size())
+            colorSize.resize(c + 1, 0);
+        colorSize[c]++;
+    }
+
+    colorStart.resize(colorSize.size() + 1);
+    colorStart[0] = 0;
+    for (unsigned c = 0; c < colorSize.size(); c++)
+        colorStart[c + 1] = colorStart[c] + colorSize[c];
+
+    vector<unsigned> next(colorStart.begin(), colorStart.end() - 1);
+    colorBone.resize(count);
+    for (unsigned b = 0; b < count; b++)
+        colorBone[next[boneColor[b]]++] = b;
+
+    colored = true;
+}
+
+/**
+ * Runs the spring simulation on a batch of bones which don't share joints.
+ * \param batch array of bone indices
+ * \param count number of bones in the batch
+ * \return maximum difference of the bone lengths from their rest lengths
+ *         before the correction
+ **/
+float SkeletonSolver::relaxBatch(const unsigned *batch, unsigned count)
+{
+    unsigned i = 0;
+    float maxResidual = 0;
+
+#if defined(__SSE2__)
+    const __m128 epsilon = _mm_set1_ps(FLT_EPSILON);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 omega = _mm_set1_ps(relaxation);
+    __m128 residuals = _mm_setzero_ps();
+
+    for (; i + 4 <= count; i += 4) {
+        const unsigned *b = batch + i;
+        unsigned a0 = j0[b[0]], a1 = j0[b[1]], a2 = j0[b[2]], a3 = j0[b[3]];
+        unsigned c0 = j1[b[0]], c1 = j1[b[1]], c2 = j1[b[2]], c3 = j1[b[3]];
+
+        __m128 ax = _mm_setr_ps(x[a0], x[a1], x[a2], x[a3]);
+        __m128 ay = _mm_setr_ps(y[a0], y[a1], y[a2], y[a3]);
+        __m128 cx = _mm_setr_ps(x[c0], x[c1], x[c2], x[c3]);
+        __m128 cy = _mm_setr_ps(y[c0], y[c1], y[c2], y[c3]);
+
+        __m128 dx = _mm_sub_ps(cx, ax);
+        __m128 dy = _mm_sub_ps(cy, ay);
+        __m128 dCurrent = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx),
+                                                 _mm_mul_ps(dy, dy)));
+
+        /* normalize only bones longer than epsilon, like Vector2D does */
+        __m128 big = _mm_cmpgt_ps(dCurrent, epsilon);
+        __m128 div = _mm_or_ps(_mm_and_ps(big, dCurrent),
+                               _mm_andnot_ps(big, one));
+        dx = _mm_div_ps(dx, div);
+        dy = _mm_div_ps(dy, div);
+
+        __m128 len = _mm_setr_ps(length[b[0]], length[b[1]],
+                                 length[b[2]], length[b[3]]);
+        __m128 lm = _mm_setr_ps(lengthMult[b[0]], lengthMult[b[1]],
+                                lengthMult[b[2]], lengthMult[b[3]]);
+        __m128 dmp = _mm_setr_ps(damp[b[0]], damp[b[1]],
+                                 damp[b[2]], damp[b[3]]);
+        __m128 residual = _mm_sub_ps(_mm_mul_ps(len, lm), dCurrent);
+        __m128 m = _mm_mul_ps(_mm_mul_ps(residual, dmp), omega);
+        residuals = _mm_max_ps(residuals, _mm_and_ps(residual, absMask));
+
+        float mx[4], my[4];
+        _mm_storeu_ps(mx, _mm_mul_ps(dx, m));
+        _mm_storeu_ps(my, _mm_mul_ps(dy, m));
+
+        /* no joint appears twice in a batch, so the corrections can be
+         * written back independently */
+        const unsigned a[4] = { a0, a1, a2, a3 };
+        const unsigned c[4] = { c0, c1, c2, c3 };
+        for (unsigned k = 0; k < 4; k++) {
+            if (!pinned[a[k]]) {
+                x[a[k]] -= mx[k];
+                y[a[k]] -= my[k];
+            }
+            if (!pinned[c[k]]) {
+                x[c[k]] += mx[k];
+                y[c[k]] += my[k];
+            }
+        }
+    }
+
+    float r[4];
+    _mm_storeu_ps(r, residuals);
+    for (unsigned k = 0; k < 4; k++) {
+        if (r[k] > maxResidual)
+            maxResidual = r[k];
+    }
+#endif
+
+    for (; i < count; i++) {
+        float r = relaxBone(batch[i]);
+        if (r > maxResidual)
+            maxResidual = r;
+    }
+
+    return maxResidual;
+}
+
+/**
+ * Runs one pass of the simulation on all joints and bones. Bones are relaxed
+ * color by color.
+ * \param gravity strength of the gravity force, 0 to turn gravity off
+ * \return maximum difference of the bone lengths from their rest lengths
+ *         before the pass
+ **/
+float SkeletonSolver::relax(float gravity /* = 0 */)
+{
+    if (gravity != 0)
+        applyGravity(gravity);
+
+    animateBones(1);
+    colorBones();
+
+    float maxResidual = 0;
+    unsigned colors = colorStart.size() - 1;
+    const unsigned maxColors = sizeof(unsigned) * CHAR_BIT;
+    for (unsigned c = 0; c < colors; c++) {
+        const unsigned *batch = &colorBone[colorStart[c]];
+        unsigned n = colorStart[c + 1] - colorStart[c];
+        float r = 0;
+        if (c < maxColors - 1) {
+            r = relaxBatch(batch, n);
+        }
+        else {
+            for (unsigned i = 0; i < n; i++) {
+                float br = relaxBone(batch[i]);
+                if (br > r)
+                    r = br;
+            }
+        }
+        if (r > maxResidual)
+            maxResidual = r;
+    }
+
+    return maxResidual;
+}
+
+/**
+ * Runs one pass of the simulation on all joints and bones, relaxing bones
+ * one by one in their original order.
+ * \param gravity strength of the gravity force, 0 to turn gravity off
+ * \return maximum difference of the bone lengths from their rest lengths
+ *         before the pass
+ **/
+float SkeletonSolver::relaxSequential(float gravity /* = 0 */)
+{
+    if (gravity != 0)
+        applyGravity(gravity);
+
+    float maxResidual = 0;
+    unsigned count = j0.size();
+    for (unsigned b = 0; b < count; b++) {
+        if (tempo[b] > 0)
+            animateBone(b);
+        float r = relaxBone(b);
+        if (r > maxResidual)
+            maxResidual = r;
+    }
+
+    return maxResidual;
+}
+
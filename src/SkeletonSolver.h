@@ -0,0 +1,110 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __SKELETONSOLVER_H__
+#define __SKELETONSOLVER_H__
+
+#include <vector>
+
+#include "Vector2D.h"
+
+using namespace std;
+
+namespace Animata
+{
+
+/// Packed state of the spring simulation of a Skeleton.
+/**
+ * Joint and bone parameters are kept in parallel arrays and bones refer to
+ * their endpoints by joint index, so a relaxation pass walks contiguous
+ * memory instead of chasing Joint and Bone pointers.
+ *
+ * Bones are partitioned into colors, so that no two bones of the same color
+ * share a joint. The bones of a color do not depend on each other and are
+ * relaxed four at a time with SSE instructions where available.
+ **/
+class SkeletonSolver
+{
+public:
+    SkeletonSolver();
+
+    void clear(void);
+
+    unsigned addJoint(const Vector2D& p, bool pinned = false);
+    unsigned addBone(unsigned j0, unsigned j1, float length);
+
+    void applyGravity(float force);
+    void animateBone(unsigned b, int passes = 1);
+    void animateBones(int passes);
+    float relaxBone(unsigned b);
+    float relax(float gravity = 0);
+    float relaxSequential(float gravity = 0);
+
+    /// Sets the over-relaxation factor of the bone corrections.
+    inline void setRelaxation(float r) { relaxation = r; }
+    /// Returns the over-relaxation factor.
+    inline float getRelaxation(void) const { return relaxation; }
+
+    /// Returns the number of bone colors.
+    inline unsigned getColorCount(void)
+        { colorBones(); return colorStart.size() - 1; }
+
+    /// Returns the number of joints.
+    inline unsigned getJointCount(void) const { return x.size(); }
+    /// Returns the number of bones.
+    inline unsigned getBoneCount(void) const { return j0.size(); }
+
+    vector<float> x;                ///< joint x coordinates
+    vector<float> y;                ///< joint y coordinates
+    /// joint is not moved by the simulation (fixed or dragged)
+    vector<unsigned char> pinned;
+
+    vector<unsigned> j0;            ///< joint index of one bone endpoint
+    vector<unsigned> j1;            ///< joint index of the other endpoint
+    vector<float> length;           ///< original bone length
+    vector<float> damp;             ///< bone stiffness
+    vector<float> lengthMult;       ///< bone length multiplier
+    vector<float> lengthMultMin;    ///< minimum of the length multiplier
+    vector<float> lengthMultMax;    ///< maximum of the length multiplier
+    vector<float> tempo;            ///< oscillator tempo, 0 if not animated
+    vector<float> time;             ///< current state of the oscillator
+
+private:
+    /** bone corrections are multiplied by this, values above 1 speed up the
+     * convergence of long chains */
+    float relaxation;
+
+    /// bone indices ordered by color
+    vector<unsigned> colorBone;
+    /// index of the first bone of each color in colorBone, plus the end
+    vector<unsigned> colorStart;
+    bool colored; ///< false if bones were added since the last coloring
+
+    void colorBones(void);
+    float relaxBatch(const unsigned *batch, unsigned count);
+};
+
+} /* namespace Animata */
+
+#endif
+
@@ -0,0 +1,179 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* shader functions are part of OpenGL 2.0 */
+#define GL_GLEXT_PROTOTYPES
+
+#include <stdio.h>
+
+#if defined(__APPLE__)
+#include <OPENGL/gl.h>
+#include <OPENGL/glext.h>
+#else
+#include <GL/gl.h>
+#include <GL/glext.h>
+#endif
+
+#include "SkinShader.h"
+
+using namespace Animata;
+
+int SkinShader::state = -1;
+GLuint SkinShader::program = 0;
+GLint SkinShader::bonesLocation = -1;
+GLint SkinShader::viewMatrixLocation = -1;
+GLint SkinShader::viewportLocation = -1;
+
+/* GLSL 1.10 source of the vertex shader following the MAX_BONES define,
+ * every bone is a vec4 of its centre and direction, the vertex is given as
+ * the cosine and sine components of its offset from the bone centre */
+static const char *vertexSource =
+    "uniform vec4 bones[MAX_BONES];\n"
+    "uniform mat4 viewMatrix;\n"
+    "uniform vec4 viewport;\n"
+    "attribute vec4 boneIndex;\n"
+    "attribute vec4 boneWeight;\n"
+    "attribute vec4 boneCos;\n"
+    "attribute vec4 boneSin;\n"
+    "\n"
+    "vec2 target(float index, float c, float s)\n"
+    "{\n"
+    "    vec4 b = bones[int(index)];\n"
+    "    return b.xy + vec2(b.z * c - b.w * s, b.z * s + b.w * c);\n"
+    "}\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    vec2 p = gl_Vertex.xy;\n"
+    "    float sumW = dot(boneWeight, vec4(1.0));\n"
+    "    if (sumW > 0.0) {\n"
+    "        p = (boneWeight.x * target(boneIndex.x, boneCos.x, boneSin.x) +\n"
+    "             boneWeight.y * target(boneIndex.y, boneCos.y, boneSin.y) +\n"
+    "             boneWeight.z * target(boneIndex.z, boneCos.z, boneSin.z) +\n"
+    "             boneWeight.w * target(boneIndex.w, boneCos.w, boneSin.w)) /\n"
+    "            sumW;\n"
+    "    }\n"
+    "\n"
+    "    /* window coordinates as projected on the CPU, drawn in the ortho\n"
+    "     * projection set up for the view coordinates */\n"
+    "    vec4 clip = viewMatrix * vec4(p, 0.0, 1.0);\n"
+    "    vec2 window = viewport.xy +\n"
+    "                  viewport.zw * (clip.xy / clip.w * 0.5 + 0.5);\n"
+    "    gl_Position = gl_ModelViewProjectionMatrix * vec4(window, 0.0, 1.0);\n"
+    "    gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+    "    gl_FrontColor = gl_Color;\n"
+    "}\n";
+
+/**
+ * Compiles and links the shader program.
+ * \retval bool true if the program could be built
+ **/
+bool SkinShader::build(void)
+{
+    const char *version = (const char *)glGetString(GL_VERSION);
+    int major = 0;
+    if ((version == NULL) || (sscanf(version, "%d", &major) != 1) ||
+        (major < 2))
+        return false;
+
+    GLint status;
+    char log[1024];
+
+    char defines[64];
+    snprintf(defines, sizeof(defines), "#define MAX_BONES %d\n", MAX_BONES);
+    const char *sources[2] = { defines, vertexSource };
+
+    GLuint shader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(shader, 2, sources, NULL);
+    glCompileShader(shader);
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (!status) {
+        glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+        fprintf(stderr, "skin shader compilation failed: %s\n", log);
+        glDeleteShader(shader);
+        return false;
+    }
+
+    program = glCreateProgram();
+    glAttachShader(program, shader);
+    glBindAttribLocation(program, ATTRIB_BONE_INDEX, "boneIndex");
+    glBindAttribLocation(program, ATTRIB_BONE_WEIGHT, "boneWeight");
+    glBindAttribLocation(program, ATTRIB_BONE_COS, "boneCos");
+    glBindAttribLocation(program, ATTRIB_BONE_SIN, "boneSin");
+    glLinkProgram(program);
+    /* the program keeps the shader until it is deleted */
+    glDeleteShader(shader);
+
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (!status) {
+        glGetProgramInfoLog(program, sizeof(log), NULL, log);
+        fprintf(stderr, "skin shader linking failed: %s\n", log);
+        glDeleteProgram(program);
+        program = 0;
+        return false;
+    }
+
+    bonesLocation = glGetUniformLocation(program, "bones");
+    viewMatrixLocation = glGetUniformLocation(program, "viewMatrix");
+    viewportLocation = glGetUniformLocation(program, "viewport");
+
+    return true;
+}
+
+/**
+ * Returns true if the shader can be used. The program is built on the first
+ * call, which needs a current OpenGL context.
+ **/
+bool SkinShader::isAvailable(void)
+{
+    if (state < 0)
+        state = build();
+
+    return state;
+}
+
+/**
+ * Starts drawing with the shader.
+ * \param bones     centre x, y and direction x, y of every bone
+ * \param count     number of bones, at most MAX_BONES
+ * \param view      projection and modelview matrix of the layer in
+ *                  column-major order, see Transform::getViewMatrix()
+ * \param viewport  viewport the layer coordinates are projected to
+ **/
+void SkinShader::begin(const float *bones, unsigned count, const float *view,
+                       const float *viewport)
+{
+    glUseProgram(program);
+    glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, view);
+    glUniform4fv(viewportLocation, 1, viewport);
+    if (count)
+        glUniform4fv(bonesLocation, count, bones);
+}
+
+/**
+ * Ends drawing with the shader and returns to the fixed function pipeline.
+ **/
+void SkinShader::end(void)
+{
+    glUseProgram(0);
+}
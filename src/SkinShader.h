@@ -0,0 +1,86 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __SKINSHADER_H__
+#define __SKINSHADER_H__
+
+#if defined(__APPLE__)
+#include <OPENGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+namespace Animata
+{
+
+/// Vertex shader moving the attached vertices with the bones when drawn.
+/**
+ * The centre and direction of every bone are uploaded as uniforms, the
+ * bones of a vertex with their weights and the position of the vertex
+ * relative to them come from vertex attributes. The shader moves the
+ * vertex to the weighted average of its bone targets, which is the pose
+ * the CPU skinning in SkinTable converges to, and projects it the same way
+ * as Transform::projectPoints(). The fragment stage is left to the fixed
+ * function pipeline.
+ *
+ * The program is built on first use and shared by all meshes. It needs
+ * OpenGL 2.0, callers have to fall back to CPU skinning if isAvailable()
+ * returns false.
+ **/
+class SkinShader
+{
+public:
+    /// maximum number of bones of a skeleton skinned by the shader
+    static const int MAX_BONES = 96;
+    /// maximum number of bones a vertex is skinned by
+    static const int MAX_INFLUENCES = 4;
+
+    /// generic vertex attribute indices of the bone data
+    enum {
+        ATTRIB_BONE_INDEX = 1,
+        ATTRIB_BONE_WEIGHT,
+        ATTRIB_BONE_COS,
+        ATTRIB_BONE_SIN
+    };
+
+    static bool isAvailable(void);
+
+    static void begin(const float *bones, unsigned count, const float *view,
+                      const float *viewport);
+    static void end(void);
+
+private:
+    static int state;       ///< 1 if the program is built, 0 if it failed
+    static GLuint program;  ///< the shader program
+
+    static GLint bonesLocation;         ///< location of the bone uniform
+    static GLint viewMatrixLocation;    ///< location of the view matrix
+    static GLint viewportLocation;      ///< location of the viewport
+
+    static bool build(void);
+};
+
+} /* namespace Animata */
+
+#endif
+
@@ -0,0 +1,279 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <math.h>
+#include <float.h>
+#include <map>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "SkinTable.h"
+
+using namespace Animata;
+
+/**
+ * Creates an empty table.
+ **/
+SkinTable::SkinTable()
+{
+    clear();
+}
+
+/**
+ * Removes all vertices from the table.
+ **/
+void SkinTable::clear(void)
+{
+    x.clear();
+    y.clear();
+    vertices.clear();
+    rowStart.clear();
+    rowStart.push_back(0);
+
+    bone.clear();
+    ca.clear();
+    sa.clear();
+    weight.clear();
+    passWeight.clear();
+    passes = 0;
+
+    targetX.clear();
+    targetY.clear();
+}
+
+/**
+ * Builds the table from the vertices attached to the given bones. Bones are
+ * referred to by their index in the vector, which has to match the bone
+ * indices of the solver used for skinning.
+ * \param bones pointer to bones vector
+ **/
+void SkinTable::build(vector<Bone *> *bones)
+{
+    clear();
+
+    map<Vertex *, unsigned> row;
+    vector<unsigned> count;
+
+    /* number the attached vertices and count their bones */
+    for (unsigned i = 0; i < bones->size(); i++) {
+        float *d, *w, *c, *s;
+        vector<Vertex *> *verts =
+            (*bones)[i]->getAttachedVertices(&d, &w, &c, &s);
+
+        for (unsigned j = 0; j < verts->size(); j++) {
+            Vertex *v = (*verts)[j];
+            map<Vertex *, unsigned>::iterator r = row.find(v);
+            if (r == row.end()) {
+                row[v] = vertices.size();
+                vertices.push_back(v);
+                count.push_back(1);
+            }
+            else {
+                count[r->second]++;
+            }
+        }
+    }
+
+    unsigned rows = vertices.size();
+    rowStart.resize(rows + 1);
+    for (unsigned r = 0; r < rows; r++)
+        rowStart[r + 1] = rowStart[r] + count[r];
+
+    unsigned entries = rowStart[rows];
+    bone.resize(entries);
+    ca.resize(entries);
+    sa.resize(entries);
+    weight.resize(entries);
+    targetX.resize(entries);
+    targetY.resize(entries);
+    x.resize(rows);
+    y.resize(rows);
+
+    /* fill the rows, entries of a row are ordered by bone index */
+    vector<unsigned> next(rowStart.begin(), rowStart.end() - 1);
+    for (unsigned i = 0; i < bones->size(); i++) {
+        float *d, *w, *c, *s;
+        vector<Vertex *> *verts =
+            (*bones)[i]->getAttachedVertices(&d, &w, &c, &s);
+
+        for (unsigned j = 0; j < verts->size(); j++) {
+            unsigned e = next[row[(*verts)[j]]]++;
+            bone[e] = i;
+            ca[e] = c[j];
+            sa[e] = s[j];
+            weight[e] = w[j];
+        }
+    }
+}
+
+/**
+ * Computes the entry weights for the given number of passes. A vertex pulled
+ * p times towards a target with weight w gets as far as pulling it once
+ * with weight 1 - (1 - w)^p.
+ * \param p number of passes
+ **/
+void SkinTable::computePassWeights(int p)
+{
+    unsigned entries = weight.size();
+    passWeight.resize(entries);
+    for (unsigned e = 0; e < entries; e++) {
+        if (p > 1)
+            passWeight[e] = 1.0f - powf(1.0f - weight[e], (float)p);
+        else
+            passWeight[e] = weight[e];
+    }
+    passes = p;
+}
+
+/**
+ * Computes the target position of every entry multiplied by its weight.
+ **/
+void SkinTable::computeTargets(void)
+{
+    unsigned entries = bone.size();
+    unsigned e = 0;
+
+#if defined(__SSE2__)
+    for (; e + 4 <= entries; e += 4) {
+        const unsigned *b = &bone[e];
+
+        __m128 cx = _mm_setr_ps(centerX[b[0]], centerX[b[1]],
+                                centerX[b[2]], centerX[b[3]]);
+        __m128 cy = _mm_setr_ps(centerY[b[0]], centerY[b[1]],
+                                centerY[b[2]], centerY[b[3]]);
+        __m128 dx = _mm_setr_ps(dirX[b[0]], dirX[b[1]],
+                                dirX[b[2]], dirX[b[3]]);
+        __m128 dy = _mm_setr_ps(dirY[b[0]], dirY[b[1]],
+                                dirY[b[2]], dirY[b[3]]);
+
+        __m128 c = _mm_loadu_ps(&ca[e]);
+        __m128 s = _mm_loadu_ps(&sa[e]);
+        __m128 w = _mm_loadu_ps(&passWeight[e]);
+
+        __m128 tx = _mm_add_ps(cx, _mm_sub_ps(_mm_mul_ps(dx, c),
+                                              _mm_mul_ps(dy, s)));
+        __m128 ty = _mm_add_ps(cy, _mm_add_ps(_mm_mul_ps(dx, s),
+                                              _mm_mul_ps(dy, c)));
+
+        _mm_storeu_ps(&targetX[e], _mm_mul_ps(tx, w));
+        _mm_storeu_ps(&targetY[e], _mm_mul_ps(ty, w));
+    }
+#endif
+
+    for (; e < entries; e++) {
+        unsigned b = bone[e];
+        float w = passWeight[e];
+        targetX[e] = (centerX[b] + dirX[b] * ca[e] - dirY[b] * sa[e]) * w;
+        targetY[e] = (centerY[b] + dirX[b] * sa[e] + dirY[b] * ca[e]) * w;
+    }
+}
+
+/**
+ * Moves the attached vertices towards the bones of the solver.
+ * Every bone pulls a vertex towards the position it had relative to the bone
+ * centre when it was attached. A vertex of several bones moves towards the
+ * weighted average of their targets, as far as the bones would pull it one
+ * after the other.
+ * \param solver solver holding the bone positions
+ * \param passes number of times the vertices are pulled, see
+ *        computePassWeights()
+ * \param settle move the vertices all the way to their targets
+ * \return the squared length of the largest vertex movement
+ **/
+float SkinTable::skin(const SkeletonSolver *solver, int passes /* = 1 */,
+                      bool settle /* = false */)
+{
+    unsigned rows = vertices.size();
+    if (rows == 0)
+        return 0;
+
+    if (passes != this->passes)
+        computePassWeights(passes);
+
+    unsigned boneCount = solver->getBoneCount();
+    centerX.resize(boneCount);
+    centerY.resize(boneCount);
+    dirX.resize(boneCount);
+    dirY.resize(boneCount);
+    for (unsigned b = 0; b < boneCount; b++) {
+        float x0 = solver->x[solver->j0[b]];
+        float y0 = solver->y[solver->j0[b]];
+        float x1 = solver->x[solver->j1[b]];
+        float y1 = solver->y[solver->j1[b]];
+
+        float dx = x1 - x0;
+        float dy = y1 - y0;
+        float len = sqrtf(dx * dx + dy * dy);
+        if (len > FLT_EPSILON) {
+            dx /= len;
+            dy /= len;
+        }
+
+        centerX[b] = (x0 + x1) * .5f;
+        centerY[b] = (y0 + y1) * .5f;
+        dirX[b] = dx;
+        dirY[b] = dy;
+    }
+
+    computeTargets();
+
+    float maxMove = 0;
+    for (unsigned r = 0; r < rows; r++) {
+        float sumW = 0;
+        float sumX = 0;
+        float sumY = 0;
+        float keep = 1;
+        for (unsigned e = rowStart[r]; e < rowStart[r + 1]; e++) {
+            float w = passWeight[e];
+            sumW += w;
+            sumX += targetX[e];
+            sumY += targetY[e];
+            keep *= 1.0f - w;
+        }
+
+        const Vector2D& coord = vertices[r]->coord;
+        float mx = 0;
+        float my = 0;
+        if (sumW > 0) {
+            float s = (settle ? 1.0f : 1.0f - keep) / sumW;
+            mx = (sumX - coord.x * sumW) * s;
+            my = (sumY - coord.y * sumW) * s;
+        }
+        x[r] = coord.x + mx;
+        y[r] = coord.y + my;
+
+        float move = mx * mx + my * my;
+        if (move > maxMove)
+            maxMove = move;
+    }
+
+    for (unsigned r = 0; r < rows; r++) {
+        vertices[r]->coord.x = x[r];
+        vertices[r]->coord.y = y[r];
+    }
+
+    return maxMove;
+}
+
@@ -0,0 +1,98 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __SKINTABLE_H__
+#define __SKINTABLE_H__
+
+#include <vector>
+
+#include "Bone.h"
+#include "SkeletonSolver.h"
+
+using namespace std;
+
+namespace Animata
+{
+
+/// Vertex to bone attachment table of a mesh.
+/**
+ * The attachments of all bones of a skeleton are collected into a
+ * compressed sparse row table with one row for every attached vertex. Each
+ * entry of a row holds the index of a bone, the position of the vertex
+ * relative to the bone centre and the weight of the bone.
+ *
+ * Skinning first computes the weighted target of every entry, four at a
+ * time with SSE instructions where available, and then blends the entries
+ * of each row into the contiguous vertex position buffer. Vertices attached
+ * to several bones move towards the weighted average of the bone targets
+ * regardless of the order of the bones.
+ **/
+class SkinTable
+{
+public:
+    SkinTable();
+
+    void clear(void);
+    void build(vector<Bone *> *bones);
+
+    float skin(const SkeletonSolver *solver, int passes = 1,
+               bool settle = false);
+
+    /// Returns the number of attached vertices.
+    inline unsigned getVertexCount(void) const { return vertices.size(); }
+    /// Returns the number of vertex to bone attachments.
+    inline unsigned getEntryCount(void) const { return bone.size(); }
+
+    vector<float> x;    ///< skinned vertex x coordinates, one per row
+    vector<float> y;    ///< skinned vertex y coordinates, one per row
+
+private:
+    vector<Vertex *> vertices;  ///< attached vertex of each row
+    /// index of the first entry of each row, plus the end
+    vector<unsigned> rowStart;
+
+    vector<unsigned> bone;      ///< bone index of each entry
+    vector<float> ca;           ///< vertex offset along the bone
+    vector<float> sa;           ///< vertex offset perpendicular to the bone
+    vector<float> weight;       ///< weight of the bone on the vertex
+
+    /** weights of the entries for the number of passes last skinned with */
+    vector<float> passWeight;
+    int passes; ///< passes the pass weights were computed for, 0 if none
+
+    vector<float> centerX;      ///< bone centre x coordinates
+    vector<float> centerY;      ///< bone centre y coordinates
+    vector<float> dirX;         ///< x component of the bone directions
+    vector<float> dirY;         ///< y component of the bone directions
+
+    vector<float> targetX;      ///< weighted target x of each entry
+    vector<float> targetY;      ///< weighted target y of each entry
+
+    void computePassWeights(int p);
+    void computeTargets(void);
+};
+
+} /* namespace Animata */
+
+#endif
+
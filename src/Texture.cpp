@@ -43,11 +43,6 @@ using namespace Animata;
 Texture::Texture(const char *filename, const Vector2D& dim, int d,
                  unsigned char* p, int reuseResource)
 {
-    sWrap = tWrap = GL_CLAMP;
-
-    minFilter = GL_LINEAR_MIPMAP_LINEAR;
-    magFilter = GL_LINEAR;
-
     this->filename = filename;
 
     dimensions = dim;
@@ -57,6 +52,14 @@ Texture::Texture(const char *filename, const Vector2D& dim, int d,
 
     scale = 1.f;
 
+#ifndef ANIMATA_HEADLESS
+    sWrap = tWrap = GL_CLAMP;
+
+    minFilter = GL_LINEAR_MIPMAP_LINEAR;
+    magFilter = GL_LINEAR;
+
+    setAtlasRegion(0, NULL);
+
     if(!reuseResource) {
         // required because the data isnt padded at the end of each texel row
         glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
@@ -73,6 +76,7 @@ Texture::Texture(const char *filename, const Vector2D& dim, int d,
     else {
         glResource = reuseResource;
     }
+#endif
 }
 
 /**
@@ -80,7 +84,9 @@ Texture::Texture(const char *filename, const Vector2D& dim, int d,
  */
 Texture::~Texture()
 {
+#ifndef ANIMATA_HEADLESS
     glDeleteTextures(1, &glResource);
+#endif
 }
 
 /**
@@ -89,7 +95,11 @@ Texture::~Texture()
  */
 Texture *Texture::clone()
 {
+#ifndef ANIMATA_HEADLESS
     return new Texture(filename, dimensions, depth, data, glResource);
+#else
+    return new Texture(filename, dimensions, depth, data);
+#endif
 }
 
 /**
@@ -164,6 +174,23 @@ int Texture::getTriangleAlpha(const Vector2D& p0, const Vector2D& p1,
     return alpha;
 }
 
+#ifndef ANIMATA_HEADLESS
+/**
+ * Sets the TextureAtlas page the texture was copied to.
+ * \param page      OpenGL resource of the page, 0 if the texture is not in
+ *                  an atlas
+ * \param region    offset and size of the texture in texture coordinates of
+ *                  the page, the whole page if NULL
+ */
+void Texture::setAtlasRegion(GLuint page, const float *region)
+{
+    atlasResource = page;
+    atlasRegion[0] = region ? region[0] : 0.f;
+    atlasRegion[1] = region ? region[1] : 0.f;
+    atlasRegion[2] = region ? region[2] : 1.f;
+    atlasRegion[3] = region ? region[3] : 1.f;
+}
+
 /**
  * Draws the texture on a textured quad at the screen-coordinates.
  * If \c mouseOver is true, a border gets also be drawn around the quad.
@@ -197,4 +224,5 @@ void Texture::draw(int mouseOver)
 
     glEnd();
 }
+#endif
 
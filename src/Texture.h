@@ -24,6 +24,7 @@
 #ifndef __TEXTURE_H__
 #define __TEXTURE_H__
 
+#ifndef ANIMATA_HEADLESS
 #if defined(__APPLE__)
 #include <OPENGL/gl.h>
 #include <OPENGL/glu.h>
@@ -31,6 +32,7 @@
 #include <GL/gl.h>
 #include <GL/glu.h>
 #endif
+#endif
 
 #include "Vector2D.h"
 
@@ -46,6 +48,7 @@ private:
 
     float scale;            ///< scale multiplier for the size
 
+#ifndef ANIMATA_HEADLESS
     GLuint glResource;      ///< OpenGL resource of the texture
 
     int sWrap;              ///< \c GL_TEXTURE_WRAP_S OpenGL parameter
@@ -54,6 +57,10 @@ private:
     int minFilter;          ///< \c GL_TEXTURE_MIN_FILTER OpenGL parameter
     int magFilter;          ///< \c GL_TEXTURE_MAG_FILTER OpenGL parameter
 
+    GLuint atlasResource;   ///< TextureAtlas page holding the texture, or 0
+    float atlasRegion[4];   ///< offset and size of the texture on the page
+#endif
+
     const char *filename;   ///< filename from which the texture is created
 
     int getTexelAlpha(const Vector2D& p);
@@ -74,7 +81,9 @@ public:
             int reuseResource = 0);
     ~Texture();
 
+#ifndef ANIMATA_HEADLESS
     void draw(int mouseOver = 0);
+#endif
 
     int getTriangleAlpha(const Vector2D& p0, const Vector2D& p1,
                          const Vector2D& p2, int maxIter = 3, int iterLevel = 1);
@@ -87,6 +96,12 @@ public:
      */
     inline unsigned char* getData() { return data; }
 
+    /**
+     * Returns the number of bytes per pixel in the data of the texture.
+     * \retval int Color depth.
+     */
+    inline int getDepth() const { return depth; }
+
     /**
      * Returns scale multiplier of the texture.
      * \retval float Scale multiplier.
@@ -104,12 +119,30 @@ public:
      */
     inline const Vector2D& getDimensions() const { return dimensions; }
 
+#ifndef ANIMATA_HEADLESS
     /**
      * Returns the OpenGL resource which holds the texture.
      * \retval GLuint OpenGL resource that represent the texture.
      */
     inline GLuint getGlResource() { return glResource; }
 
+    /**
+     * Returns the TextureAtlas page holding a copy of the texture.
+     * \retval GLuint OpenGL resource of the page, 0 if the texture is not in
+     *         an atlas.
+     */
+    inline GLuint getAtlasResource() { return atlasResource; }
+
+    /**
+     * Returns where the texture is on its atlas page.
+     * \retval const float* Offset and size of the texture in texture
+     *         coordinates of the page.
+     */
+    inline const float *getAtlasRegion() { return atlasRegion; }
+
+    void setAtlasRegion(GLuint page, const float *region);
+#endif
+
     /**
      * Returns the filename from which the texture was created.
      * \retval const char* String of the filename.
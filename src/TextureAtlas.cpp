@@ -0,0 +1,229 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <algorithm>
+
+/* GL_TEXTURE_MAX_LEVEL is part of OpenGL 1.2 */
+#if defined(__APPLE__)
+#include <OPENGL/gl.h>
+#include <OPENGL/glext.h>
+#include <OPENGL/glu.h>
+#else
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <GL/glu.h>
+#endif
+
+#include "TextureAtlas.h"
+
+using namespace Animata;
+
+/**
+ * Orders the atlas items by decreasing height for packing them into
+ * shelves.
+ **/
+bool TextureAtlas::compareHeight(const Item& a, const Item& b)
+{
+    return a.h > b.h;
+}
+
+/**
+ * Creates an empty atlas.
+ **/
+TextureAtlas::TextureAtlas()
+{
+    pageSize = 0;
+}
+
+/**
+ * Deletes the pages of the atlas.
+ **/
+TextureAtlas::~TextureAtlas()
+{
+    clear();
+}
+
+/**
+ * Deletes the pages of the atlas.
+ **/
+void TextureAtlas::clear(void)
+{
+    if (!pages.empty())
+        glDeleteTextures(pages.size(), &pages[0]);
+    pages.clear();
+    pageSize = 0;
+}
+
+/**
+ * Places the items on pages of the given size in rows of decreasing
+ * height. The items have to be sorted by their height.
+ * \param items items to place
+ * \param size  width and height of the pages
+ * \retval unsigned number of pages needed, 0 if an item does not fit on a
+ *         page
+ **/
+unsigned TextureAtlas::pack(vector<Item>& items, int size)
+{
+    int x = 0, y = 0, rowHeight = 0;
+    unsigned page = 0;
+
+    for (unsigned i = 0; i < items.size(); i++) {
+        Item& item = items[i];
+        if ((item.w > size) || (item.h > size))
+            return 0;
+
+        // next row
+        if (x + item.w > size) {
+            x = 0;
+            y += rowHeight;
+            rowHeight = 0;
+        }
+        // next page
+        if (y + item.h > size) {
+            x = y = 0;
+            page++;
+        }
+
+        item.x = x;
+        item.y = y;
+        item.page = page;
+
+        x += item.w;
+        rowHeight = std::max(rowHeight, item.h);
+    }
+
+    return page + 1;
+}
+
+/**
+ * Creates the OpenGL texture of a page from the textures placed on it.
+ * \param items textures placed in the atlas
+ * \param page  index of the page to create
+ * \retval GLuint the OpenGL texture
+ **/
+GLuint TextureAtlas::createPage(vector<Item>& items, unsigned page)
+{
+    vector<unsigned char> texels(pageSize * pageSize * 4, 0);
+
+    for (unsigned i = 0; i < items.size(); i++) {
+        Item& item = items[i];
+        if (item.page != page)
+            continue;
+
+        Texture *t = item.texture;
+        const unsigned char *data = t->getData();
+        int depth = t->getDepth();
+        int w = (int)t->getDimensions().x;
+        int h = (int)t->getDimensions().y;
+
+        // repeat the edges of the texture over the padding
+        for (int y = 0; y < item.h; y++) {
+            int sy = std::min(std::max(y - PADDING, 0), h - 1);
+            unsigned char *dst = &texels[((item.y + y) * pageSize + item.x) * 4];
+            for (int x = 0; x < item.w; x++, dst += 4) {
+                int sx = std::min(std::max(x - PADDING, 0), w - 1);
+                const unsigned char *src = data + (sy * w + sx) * depth;
+                dst[0] = src[0];
+                dst[1] = src[1];
+                dst[2] = src[2];
+                dst[3] = (depth == 4) ? src[3] : 255;
+            }
+        }
+    }
+
+    GLuint resource;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glGenTextures(1, &resource);
+    glBindTexture(GL_TEXTURE_2D, resource);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                    GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, MAX_LEVEL);
+    gluBuild2DMipmaps(GL_TEXTURE_2D, GL_RGBA, pageSize, pageSize, GL_RGBA,
+                      GL_UNSIGNED_BYTE, &texels[0]);
+
+    return resource;
+}
+
+/**
+ * Packs the textures into the atlas again, replacing the previous pages.
+ * The pages are made as small as possible, more than one page is only used
+ * if the textures do not fit on the largest one. Textures larger than a
+ * page are left out of the atlas.
+ * \param textures  textures to pack
+ **/
+void TextureAtlas::build(vector<Texture *> *textures)
+{
+    clear();
+
+    GLint maxSize;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    maxSize = std::min((int)maxSize, (int)MAX_PAGE_SIZE);
+
+    vector<Item> items;
+    for (unsigned i = 0; i < textures->size(); i++) {
+        Texture *t = (*textures)[i];
+        t->setAtlasRegion(0, NULL);
+
+        if ((t->getData() == NULL) ||
+            ((t->getDepth() != 3) && (t->getDepth() != 4)))
+            continue;
+
+        // keep the textures aligned to the mipmap blocks
+        Item item;
+        item.texture = t;
+        item.w = ((int)t->getDimensions().x + PADDING * 3 - 1) /
+                 PADDING * PADDING;
+        item.h = ((int)t->getDimensions().y + PADDING * 3 - 1) /
+                 PADDING * PADDING;
+        if ((item.w <= maxSize) && (item.h <= maxSize))
+            items.push_back(item);
+    }
+
+    if (items.empty())
+        return;
+
+    std::stable_sort(items.begin(), items.end(), compareHeight);
+
+    pageSize = MIN_PAGE_SIZE;
+    while ((pageSize < maxSize) && (pack(items, pageSize) != 1))
+        pageSize *= 2;
+    unsigned count = pack(items, pageSize);
+
+    for (unsigned p = 0; p < count; p++)
+        pages.push_back(createPage(items, p));
+
+    for (unsigned i = 0; i < items.size(); i++) {
+        Item& item = items[i];
+        const Vector2D& dim = item.texture->getDimensions();
+        float region[4] = {
+            (float)(item.x + PADDING) / pageSize,
+            (float)(item.y + PADDING) / pageSize,
+            dim.x / pageSize,
+            dim.y / pageSize
+        };
+        item.texture->setAtlasRegion(pages[item.page], region);
+    }
+}
@@ -0,0 +1,95 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __TEXTUREATLAS_H__
+#define __TEXTUREATLAS_H__
+
+#if defined(__APPLE__)
+#include <OPENGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#include <vector>
+
+#include "Texture.h"
+
+using namespace std;
+
+namespace Animata
+{
+
+/// Packs textures into a few large OpenGL textures.
+/**
+ * Every texture is copied onto a page of the atlas with its edge texels
+ * repeated around it, so neither the filtering nor the smaller mipmap levels
+ * mix the neighbouring textures into it. The page and the region of the
+ * texture on it are stored in the texture, meshes sharing a page can be
+ * drawn without binding another texture.
+ **/
+class TextureAtlas
+{
+public:
+    /// texels repeated around the textures, a multiple of the mipmap block
+    static const int PADDING = 8;
+    /// mipmap levels on the pages, the last one still inside the padding
+    static const int MAX_LEVEL = 3;
+    /// smallest page size tried
+    static const int MIN_PAGE_SIZE = 256;
+    /// largest page size used, if OpenGL allows so
+    static const int MAX_PAGE_SIZE = 2048;
+
+    TextureAtlas();
+    ~TextureAtlas();
+
+    void build(vector<Texture *> *textures);
+
+    /**
+     * Returns the number of pages the textures were packed into.
+     * \retval unsigned Number of pages.
+     */
+    inline unsigned getPageCount() const { return pages.size(); }
+
+private:
+    /// Place of a texture in the atlas.
+    struct Item
+    {
+        Texture *texture;
+        int w, h;       ///< size including the padding
+        int x, y;       ///< top left corner of the padding on the page
+        unsigned page;  ///< index of the page
+    };
+
+    vector<GLuint> pages;   ///< OpenGL textures of the pages
+    int pageSize;           ///< width and height of the pages
+
+    static bool compareHeight(const Item& a, const Item& b);
+    static unsigned pack(vector<Item>& items, int size);
+    GLuint createPage(vector<Item>& items, unsigned page);
+    void clear(void);
+};
+
+} /* namespace Animata */
+
+#endif
+
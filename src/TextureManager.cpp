@@ -39,6 +39,9 @@ TextureManager::TextureManager()
 {
     textures = new std::vector<Texture*>;
     pTexture = NULL;
+
+    atlas = new TextureAtlas();
+    atlasDirty = false;
 }
 
 /**
@@ -58,6 +61,8 @@ TextureManager::~TextureManager()
         textures->clear();
         delete textures;
     }
+
+    delete atlas;
 }
 
 /**
@@ -82,6 +87,7 @@ Texture *TextureManager::getTexture(const char *filename)
 void TextureManager::addTexture(Texture* t)
 {
     textures->push_back(t);
+    atlasDirty = true;
 }
 
 /**
@@ -97,10 +103,24 @@ void TextureManager::removeTexture(Texture* t)
              * which uses its gl resource */
             delete *textureIter;
             textures->erase(textureIter);
+            atlasDirty = true;
         }
     }
 }
 
+/**
+ * Packs the textures into the TextureAtlas again if any of them was added
+ * or removed since the last time. Has to be called with the OpenGL context
+ * current, before drawing the meshes.
+ **/
+void TextureManager::updateAtlas(void)
+{
+    if (atlasDirty) {
+        atlas->build(textures);
+        atlasDirty = false;
+    }
+}
+
 /**
  * Allocates a new texture based on the given ImageBox if neccessary, and adds
  * it to the TextureManager.
@@ -164,25 +184,14 @@ void TextureManager::draw(int mode)
     glColor3f(1.f, 1.f, 1.f);
     glEnable(GL_TEXTURE_2D);
 
-    glLoadName(Selection::SELECT_TEXTURE);
-    glPushName(0);
     for (unsigned int i = 0; i < textures->size(); i++) {
         Texture* tex = (*textures)[i];
 
         // draw the texture only for the mesh on the current layer
         if (ui->editorBox->getMesh()->getAttachedTexture() == tex) {
             activeTexture = tex;
-            glLoadName(i);
-
             if (mode & RENDER_FEEDBACK) {
-                glMatrixMode(GL_MODELVIEW);
-                glPushMatrix();
-                glMultMatrixf(ui->editorBox->getCurrentLayer()->getTransformationMatrix()->f);
-
-                Transform::setMatrices();
-
-                glMatrixMode(GL_MODELVIEW);
-                glPopMatrix();
+                Transform::setMatrices(ui->editorBox->getCurrentLayer()->getTransformationMatrix());
 
                 Vector3D view0 = Transform::project(Vector3D(tex->position));
                 tex->viewTopLeft.set(view0.x, view0.y);
@@ -193,8 +202,8 @@ void TextureManager::draw(int mode)
 
             if (mode & RENDER_TEXTURE) {
                 // get the boundaries of actual viewport
-                GLint viewport[4];
-                glGetIntegerv(GL_VIEWPORT, viewport);
+                float viewport[4];
+                Transform::getViewport(viewport);
 
                 glMatrixMode(GL_PROJECTION);
                 glPushMatrix();
@@ -217,6 +226,5 @@ void TextureManager::draw(int mode)
             }
         }
     }
-    glPopName();
     glDisable(GL_TEXTURE_2D);
 }
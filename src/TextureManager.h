@@ -26,6 +26,7 @@
 
 #include <vector>
 #include "Texture.h"
+#include "TextureAtlas.h"
 #include "ImageBox.h"
 
 using namespace std;
@@ -43,6 +44,9 @@ private:
     Texture *pTexture;          ///< texture below the mouse cursor
     Texture *activeTexture;     ///< texture attached to the mesh on currently active layer
 
+    TextureAtlas *atlas;        ///< atlas the textures are packed into
+    bool atlasDirty;            ///< set if the textures changed since packing
+
     /// Adds an already allocated texture to the manager.
     void addTexture(Texture* t);
 
@@ -60,6 +64,9 @@ public:
     /// get texture with given name
     Texture *getTexture(const char *name);
 
+    /// packs the textures into the atlas again if they have changed
+    void updateAtlas(void);
+
     void draw(int mode);
 
     /**
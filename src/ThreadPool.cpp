@@ -0,0 +1,214 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <unistd.h>
+
+#include "ThreadPool.h"
+
+using namespace Animata;
+
+/**
+ * Creates the pool and starts its worker threads.
+ * \param threads number of threads including the calling one, the number of
+ *        processor cores if 0
+ **/
+ThreadPool::ThreadPool(int threads /* = 0 */)
+{
+    if (threads <= 0)
+        threads = getCoreCount();
+
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&start, NULL);
+    pthread_cond_init(&done, NULL);
+    batch = 0;
+    pending = 0;
+    quit = false;
+
+    for (int i = 0; i < threads; i++) {
+        Queue *q = new Queue;
+        pthread_mutex_init(&q->mutex, NULL);
+        queues.push_back(q);
+    }
+
+    /* the first queue belongs to the thread calling run() */
+    for (int i = 1; i < threads; i++) {
+        Worker *w = new Worker;
+        w->pool = this;
+        w->queue = i;
+        pthread_create(&w->thread, NULL, &threadFunc, w);
+        workers.push_back(w);
+    }
+}
+
+/**
+ * Stops the worker threads and destroys the pool.
+ **/
+ThreadPool::~ThreadPool()
+{
+    pthread_mutex_lock(&mutex);
+    quit = true;
+    pthread_cond_broadcast(&start);
+    pthread_mutex_unlock(&mutex);
+
+    for (unsigned i = 0; i < workers.size(); i++) {
+        pthread_join(workers[i]->thread, NULL);
+        delete workers[i];
+    }
+
+    for (unsigned i = 0; i < queues.size(); i++) {
+        pthread_mutex_destroy(&queues[i]->mutex);
+        delete queues[i];
+    }
+
+    pthread_cond_destroy(&done);
+    pthread_cond_destroy(&start);
+    pthread_mutex_destroy(&mutex);
+}
+
+/**
+ * Returns the number of online processor cores.
+ **/
+int ThreadPool::getCoreCount(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? (int)n : 1;
+}
+
+/**
+ * Runs the given tasks on the pool threads and waits until all of them are
+ * finished.
+ * \param tasks vector of tasks, they are not deleted
+ **/
+void ThreadPool::run(vector<Task *> *tasks)
+{
+    unsigned count = tasks->size();
+    if (count == 0)
+        return;
+
+    /* no need to wake up the workers for a single task */
+    if ((count == 1) || workers.empty()) {
+        for (unsigned i = 0; i < count; i++)
+            (*tasks)[i]->run();
+        return;
+    }
+
+    /* deal the tasks to the queues */
+    for (unsigned i = 0; i < count; i++) {
+        Queue *q = queues[i % queues.size()];
+        pthread_mutex_lock(&q->mutex);
+        q->tasks.push_back((*tasks)[i]);
+        pthread_mutex_unlock(&q->mutex);
+    }
+
+    pthread_mutex_lock(&mutex);
+    pending = count;
+    batch++;
+    pthread_cond_broadcast(&start);
+    pthread_mutex_unlock(&mutex);
+
+    runTasks(0);
+
+    pthread_mutex_lock(&mutex);
+    while (pending > 0)
+        pthread_cond_wait(&done, &mutex);
+    pthread_mutex_unlock(&mutex);
+}
+
+/**
+ * Takes a task from the back of the given queue, or steals one from the
+ * front of another queue if it is empty.
+ * \param q index of the queue of the calling thread
+ * \return pointer to the task or NULL if all queues are empty
+ **/
+Task *ThreadPool::getTask(unsigned q)
+{
+    Task *task = NULL;
+
+    Queue *own = queues[q];
+    pthread_mutex_lock(&own->mutex);
+    if (!own->tasks.empty()) {
+        task = own->tasks.back();
+        own->tasks.pop_back();
+    }
+    pthread_mutex_unlock(&own->mutex);
+
+    for (unsigned i = 1; (task == NULL) && (i < queues.size()); i++) {
+        Queue *victim = queues[(q + i) % queues.size()];
+        pthread_mutex_lock(&victim->mutex);
+        if (!victim->tasks.empty()) {
+            task = victim->tasks.front();
+            victim->tasks.pop_front();
+        }
+        pthread_mutex_unlock(&victim->mutex);
+    }
+
+    return task;
+}
+
+/**
+ * Runs tasks until all queues are empty.
+ * \param q index of the queue of the calling thread
+ **/
+void ThreadPool::runTasks(unsigned q)
+{
+    Task *task;
+    while ((task = getTask(q))) {
+        task->run();
+
+        pthread_mutex_lock(&mutex);
+        if (--pending == 0)
+            pthread_cond_signal(&done);
+        pthread_mutex_unlock(&mutex);
+    }
+}
+
+void *ThreadPool::threadFunc(void *p)
+{
+    Worker *w = (Worker *)p;
+    w->pool->workerTask(w->queue);
+    return NULL;
+}
+
+/**
+ * Main function of a worker thread, waits for batches and runs their tasks.
+ * \param q index of the worker's queue
+ **/
+void ThreadPool::workerTask(unsigned q)
+{
+    unsigned seen = 0;
+
+    while (true) {
+        pthread_mutex_lock(&mutex);
+        while (!quit && (batch == seen))
+            pthread_cond_wait(&start, &mutex);
+        if (quit) {
+            pthread_mutex_unlock(&mutex);
+            break;
+        }
+        seen = batch;
+        pthread_mutex_unlock(&mutex);
+
+        runTasks(q);
+    }
+}
+
@@ -0,0 +1,102 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __THREADPOOL_H__
+#define __THREADPOOL_H__
+
+#include <pthread.h>
+#include <deque>
+#include <vector>
+
+using namespace std;
+
+namespace Animata
+{
+
+/// Unit of work run by the ThreadPool.
+class Task
+{
+public:
+    virtual ~Task() {}
+    /// Does the work, called from one of the pool threads.
+    virtual void run(void) = 0;
+};
+
+/// Worker threads sharing the tasks of a batch by work-stealing.
+/**
+ * Every thread has its own queue of tasks. A thread takes tasks from the
+ * back of its own queue and when that runs empty it steals from the front
+ * of the other queues. The thread calling run() works on the first queue,
+ * so a pool of \e n threads starts \e n-1 workers.
+ **/
+class ThreadPool
+{
+public:
+    ThreadPool(int threads = 0);
+    ~ThreadPool();
+
+    void run(vector<Task *> *tasks);
+
+    /// Returns the number of threads working on a batch.
+    inline int getThreadCount(void) const { return queues.size(); }
+
+    static int getCoreCount(void);
+
+private:
+    /// Task queue of one thread.
+    struct Queue
+    {
+        pthread_mutex_t mutex;
+        deque<Task *> tasks;
+    };
+
+    /// Arguments of a worker thread.
+    struct Worker
+    {
+        ThreadPool *pool;
+        unsigned queue;     ///< index of the worker's own queue
+        pthread_t thread;
+    };
+
+    vector<Queue *> queues;
+    vector<Worker *> workers;
+
+    pthread_mutex_t mutex;  ///< protects the fields below
+    pthread_cond_t start;   ///< signalled when a new batch is queued
+    pthread_cond_t done;    ///< signalled when the batch is finished
+    unsigned batch;         ///< number of the current batch
+    unsigned pending;       ///< tasks of the batch not finished yet
+    bool quit;              ///< set to stop the workers
+
+    /// Helper function to call workerTask() from a thread.
+    static void *threadFunc(void *p);
+    void workerTask(unsigned q);
+
+    Task *getTask(unsigned q);
+    void runTasks(unsigned q);
+};
+
+} /* namespace Animata */
+
+#endif
+
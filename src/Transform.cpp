@@ -21,23 +21,95 @@
 
 */
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "Transform.h"
 
 using namespace Animata;
 
+Matrix Transform::loadedModelView;
+Matrix Transform::loadedProjection;
+
 double Transform::modelview[16];
 double Transform::projection[16];
 GLint Transform::viewport[4];
 
 /**
- * Reads and stores the actual opengl modelview and projection matrices, and
- * viewport parameters.
+ * Loads the given matrix into the opengl modelview matrix and keeps a copy
+ * for setMatrices().
+ *
+ * \param m the new modelview matrix
  */
-void Transform::setMatrices()
+void Transform::loadModelView(const Matrix& m)
 {
-    glGetDoublev(GL_MODELVIEW_MATRIX, modelview);
-    glGetDoublev(GL_PROJECTION_MATRIX, projection);
-    glGetIntegerv(GL_VIEWPORT, viewport);
+    loadedModelView = m;
+
+    glMatrixMode(GL_MODELVIEW);
+    glLoadMatrixf(m.f);
+}
+
+/**
+ * Loads the given matrix into the opengl projection matrix and keeps a copy
+ * for setMatrices().
+ *
+ * \param m the new projection matrix
+ */
+void Transform::loadProjection(const Matrix& m)
+{
+    loadedProjection = m;
+
+    glMatrixMode(GL_PROJECTION);
+    glLoadMatrixf(m.f);
+}
+
+/**
+ * Sets the opengl viewport and stores the parameters.
+ *
+ * \param v array of 4 elements with the x, y position and the width and
+ *          height of the viewport
+ */
+void Transform::loadViewport(const int *v)
+{
+    for (int i = 0; i < 4; i++)
+        viewport[i] = v[i];
+
+    glViewport(v[0], v[1], v[2], v[3]);
+}
+
+/**
+ * Stores the transformation of the given world matrix followed by the
+ * matrices loaded by the camera. The result is the same as reading the
+ * opengl matrices back after multiplying the world matrix onto the modelview
+ * matrix.
+ *
+ * \param world transformation of the drawn object, if NULL only the camera
+ *              transformation is used
+ */
+void Transform::setMatrices(const Matrix *world /* = NULL */)
+{
+    setMatrices(world ? *world * loadedModelView : loadedModelView,
+                loadedProjection, viewport);
+}
+
+/**
+ * Stores the given modelview and projection matrices and viewport parameters
+ * without loading them into opengl.
+ *
+ * \param m modelview matrix
+ * \param p projection matrix
+ * \param v viewport parameters
+ */
+void Transform::setMatrices(const Matrix& m, const Matrix& p, const int *v)
+{
+    for (int i = 0; i < 16; i++) {
+        modelview[i] = m[i];
+        projection[i] = p[i];
+    }
+
+    for (int i = 0; i < 4; i++)
+        viewport[i] = v[i];
 }
 
 /**
@@ -55,6 +127,163 @@ Vector3D Transform::project(const Vector3D& p)
     return Vector3D(wx, wy, wz);
 }
 
+/**
+ * Projects points of the xy plane to screen coordinates in place based on the
+ * previously saved transformation parameters. The results are the same as of
+ * project() with zero z coordinate, points outside of the view volume are
+ * projected as well.
+ *
+ * \param points   x and y coordinates of the points one after the other
+ * \param count    number of points
+ */
+void Transform::projectPoints(float *points, unsigned count)
+{
+    float view[16];
+    getViewMatrix(view);
+
+    /* the rows of the view matrix, only the columns of x, y and the
+     * translation are needed for the xy plane */
+    float m[4][3];
+    for (int r = 0; r < 4; r++) {
+        m[r][0] = view[r];
+        m[r][1] = view[4 + r];
+        m[r][2] = view[12 + r];
+    }
+
+    /* window coordinates from normalized device coordinates */
+    float sx = viewport[2] * .5f;
+    float sy = viewport[3] * .5f;
+    float ox = viewport[0] + sx;
+    float oy = viewport[1] + sy;
+
+    unsigned i = 0;
+
+#if defined(__SSE2__)
+    for (; i + 4 <= count; i += 4) {
+        float *p = points + i * 2;
+
+        __m128 p01 = _mm_loadu_ps(p);
+        __m128 p23 = _mm_loadu_ps(p + 4);
+        __m128 x = _mm_shuffle_ps(p01, p23, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 y = _mm_shuffle_ps(p01, p23, _MM_SHUFFLE(3, 1, 3, 1));
+
+        __m128 cx = _mm_add_ps(_mm_add_ps(
+                        _mm_mul_ps(_mm_set1_ps(m[0][0]), x),
+                        _mm_mul_ps(_mm_set1_ps(m[0][1]), y)),
+                        _mm_set1_ps(m[0][2]));
+        __m128 cy = _mm_add_ps(_mm_add_ps(
+                        _mm_mul_ps(_mm_set1_ps(m[1][0]), x),
+                        _mm_mul_ps(_mm_set1_ps(m[1][1]), y)),
+                        _mm_set1_ps(m[1][2]));
+        __m128 cw = _mm_add_ps(_mm_add_ps(
+                        _mm_mul_ps(_mm_set1_ps(m[3][0]), x),
+                        _mm_mul_ps(_mm_set1_ps(m[3][1]), y)),
+                        _mm_set1_ps(m[3][2]));
+
+        __m128 w = _mm_div_ps(_mm_set1_ps(1), cw);
+        __m128 vx = _mm_add_ps(_mm_set1_ps(ox),
+                        _mm_mul_ps(_mm_set1_ps(sx), _mm_mul_ps(cx, w)));
+        __m128 vy = _mm_add_ps(_mm_set1_ps(oy),
+                        _mm_mul_ps(_mm_set1_ps(sy), _mm_mul_ps(cy, w)));
+
+        _mm_storeu_ps(p, _mm_unpacklo_ps(vx, vy));
+        _mm_storeu_ps(p + 4, _mm_unpackhi_ps(vx, vy));
+    }
+#endif
+
+    for (; i < count; i++) {
+        float *p = points + i * 2;
+        float x = p[0];
+        float y = p[1];
+
+        float cx = m[0][0] * x + m[0][1] * y + m[0][2];
+        float cy = m[1][0] * x + m[1][1] * y + m[1][2];
+        float w = 1.f / (m[3][0] * x + m[3][1] * y + m[3][2]);
+
+        p[0] = ox + sx * cx * w;
+        p[1] = oy + sy * cy * w;
+    }
+}
+
+/**
+ * Returns the projection matrix multiplied by the modelview matrix, which
+ * transforms points to clip coordinates, as previously saved by
+ * setMatrices().
+ *
+ * \param m array of 16 elements receiving the matrix in column-major order
+ */
+void Transform::getViewMatrix(float *m)
+{
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 4; r++) {
+            double v = 0;
+            for (int k = 0; k < 4; k++)
+                v += projection[k * 4 + r] * modelview[c * 4 + k];
+            m[c * 4 + r] = v;
+        }
+    }
+}
+
+/**
+ * Checks whether a rectangle of the xy plane can be seen with the matrices
+ * loaded by the camera. The rectangle is out of view if all of its corners
+ * are beyond the same side of the viewport. The near and far planes are not
+ * checked, as the view coordinates are not clipped by them either, see
+ * projectPoints().
+ *
+ * \param world     world matrix of the rectangle
+ * \param min       lower corner of the rectangle
+ * \param max       upper corner of the rectangle
+ * \param margin    the viewport is taken larger by this many pixels on
+ *                  each side
+ * \retval bool     false if the rectangle is out of view
+ */
+bool Transform::isVisible(const Matrix& world, const Vector2D& min,
+                          const Vector2D& max, float margin /* = 0 */)
+{
+    if ((viewport[2] <= 0) || (viewport[3] <= 0))
+        return true;
+
+    Matrix m = world * loadedModelView * loadedProjection;
+
+    /* the margin in normalized device coordinates */
+    float mx = 1.f + 2.f * margin / viewport[2];
+    float my = 1.f + 2.f * margin / viewport[3];
+
+    int left = 0, right = 0, bottom = 0, top = 0;
+    for (int i = 0; i < 4; i++) {
+        float x = (i & 1) ? max.x : min.x;
+        float y = (i & 2) ? max.y : min.y;
+
+        float cx = x * m[0] + y * m[4] + m[12];
+        float cy = x * m[1] + y * m[5] + m[13];
+        float cw = x * m[3] + y * m[7] + m[15];
+
+        /* corners behind the eye are projected mirrored */
+        if (cw <= 0)
+            return true;
+
+        left += cx < -cw * mx;
+        right += cx > cw * mx;
+        bottom += cy < -cw * my;
+        top += cy > cw * my;
+    }
+
+    return (left < 4) && (right < 4) && (bottom < 4) && (top < 4);
+}
+
+/**
+ * Returns the previously saved viewport parameters.
+ *
+ * \param v array of 4 elements receiving the x, y position and the width
+ *          and height of the viewport
+ */
+void Transform::getViewport(float *v)
+{
+    for (int i = 0; i < 4; i++)
+        v[i] = viewport[i];
+}
+
 /**
  * Unprojects a given 3D point (in screen coordinates) to world coordinates
  * based on the previously saved transformation parameters.
@@ -32,15 +32,24 @@
     #include <GL/glu.h>
 #endif
 
+#include "Vector2D.h"
 #include "Vector3D.h"
+#include "Matrix.h"
 
 namespace Animata
 {
 
-/// Transforms points between screen and world coordinate-systems.
+/**
+ * Transforms points between screen and world coordinate-systems.
+ * The matrices loaded by the camera are kept on the cpu as well, so the
+ * transformations never have to be read back from opengl.
+ **/
 class Transform
 {
 private:
+    static Matrix loadedModelView;  ///< modelview matrix loaded by the camera
+    static Matrix loadedProjection; ///< projection matrix loaded by the camera
+
     static double modelview[16];    ///< modelview matrix
     static double projection[16];   ///< projection matrix
     static GLint viewport[4];       ///< viewport parameters
@@ -49,10 +58,20 @@ public:
     Transform() {}
     virtual ~Transform () {}
 
-    static void setMatrices();
+    static void loadModelView(const Matrix& m);
+    static void loadProjection(const Matrix& m);
+    static void loadViewport(const int *v);
+
+    static void setMatrices(const Matrix *world = NULL);
+    static void setMatrices(const Matrix& m, const Matrix& p, const int *v);
 
     static Vector3D unproject(const Vector3D& p);
     static Vector3D project(const Vector3D& p);
+    static void projectPoints(float *points, unsigned count);
+    static bool isVisible(const Matrix& world, const Vector2D& min,
+                          const Vector2D& max, float margin = 0);
+    static void getViewMatrix(float *m);
+    static void getViewport(float *v);
     static float getDepth(const Vector2D& p);
 };
 
@@ -200,26 +200,18 @@ Vector3D Vector3D::operator / (float f) const
     return Vector3D(x * f, y * f, z * f);
 }
 
-Vector3D& Vector3D::rotate(const Matrix& m)
+Vector3D Vector3D::rotate(const Matrix& m) const
 {
-    Vector3D *r = new Vector3D();
-
-    r->x = x * m[0] + y * m[4] + z * m[8];
-    r->y = x * m[1] + y * m[5] + z * m[9];
-    r->z = x * m[2] + y * m[6] + z * m[10];
-
-    return *r;
+    return Vector3D(x * m[0] + y * m[4] + z * m[8],
+                    x * m[1] + y * m[5] + z * m[9],
+                    x * m[2] + y * m[6] + z * m[10]);
 }
 
-Vector3D& Vector3D::transform(const Matrix& m)
+Vector3D Vector3D::transform(const Matrix& m) const
 {
-    Vector3D *t = new Vector3D();
-
-    t->x = x * m[0] + y * m[4] + z * m[8] + m[12];
-    t->y = x * m[1] + y * m[5] + z * m[9] + m[13];
-    t->z = x * m[2] + y * m[6] + z * m[10] + m[14];
-
-    return *t;
+    return Vector3D(x * m[0] + y * m[4] + z * m[8] + m[12],
+                    x * m[1] + y * m[5] + z * m[9] + m[13],
+                    x * m[2] + y * m[6] + z * m[10] + m[14]);
 }
 
 void Vector3D::normalize(void)
@@ -68,8 +68,8 @@ public:
     Vector3D operator * (float f) const;
     Vector3D operator / (float f) const;
 
-    Vector3D& rotate(const Matrix& m);
-    Vector3D& transform(const Matrix& m);
+    Vector3D rotate(const Matrix& m) const;
+    Vector3D transform(const Matrix& m) const;
 
     void normalize(void);
     float size(void) const;
@@ -22,14 +22,19 @@
 */
 
 #include "Vertex.h"
+
+#ifndef ANIMATA_HEADLESS
 #include "Primitives.h"
+#endif
 
 using namespace Animata;
 
+#ifndef ANIMATA_HEADLESS
 void Vertex::draw(int mouseOver, int active)
 {
     Primitives::drawVertex(this, mouseOver, active);
 }
+#endif
 
 void Vertex::flipSelection(void)
 {
@@ -47,12 +47,14 @@ public:
     Vertex(Vector2D c, Vector2D tc = Vector2D())
         { coord = c; texCoord = tc; selected = false; }
 
+#ifndef ANIMATA_HEADLESS
     /**
      * Draws the Vertex onscreen.
      * \param mouseOver Indicates if the mouseOver state should be drawn.
      * \param active Indicates if the active state should be drawn.
      */
     void draw(int mouseOver = 0, int active = 1);
+#endif
 
     /// Inverts the selection state of the Vertex.
     void flipSelection(void);
@@ -23,6 +23,7 @@
 
 #include <math.h>
 #include <float.h>
+#include <string.h>
 #include <unistd.h>
 #include <algorithm>
 #include <iterator>
@@ -40,22 +41,6 @@ namespace Animata
     Selection *selector;
 }
 
-AnimataSettings::AnimataSettings()
-{
-    mode = prevMode = ANIMATA_MODE_NONE;
-    fps = 30;
-
-    playSimulation = 1;
-    iteration = 40;
-
-    gravity = 0;
-    gravityForce = 1;
-    gravityX = 0;
-    gravityY = 1;
-
-    triangulateAlphaThreshold = 100;
-}
-
 /**
  * Creates the application window.
  * \param x x-position of window
@@ -71,15 +56,14 @@ AnimataWindow::AnimataWindow(int x, int y, int w, int h, const char* l)
 
     selector = new Selection();
     textureManager = new TextureManager();
+    drawList = new DrawList();
 
     rootLayer = NULL; // FIXME: this is replaced by the vector of root layers
 
-    allLayers = NULL;
-    allBones = NULL;
-    allJoints = NULL;
-    oscJoints = NULL;
+    /* the scene elements register in the editor */
+    setContext(this);
 
-    pthread_mutex_init(&mutex, NULL);
+    simulation = new Simulation();
 
     io = new IO();
 
@@ -95,22 +79,26 @@ void AnimataWindow::startup(void)
 {
     /* the calls here require a valid AnimataUI pointer, *ui, so they cannot
      * be in the constructor */
+    setSettings(&ui->settings);
     oscListener->start();
     oscSender->start();
     newScene();
+    simulation->start();
 }
 
 AnimataWindow::~AnimataWindow()
 {
-    cleanup();
+    /* stop the simulation before the scene is destroyed */
+    delete simulation;
 
-    pthread_mutex_destroy(&mutex);
+    cleanup();
 
     delete oscListener;
     delete oscSender;
 
     delete selector;
 
+    delete drawList;
     delete textureManager;
     delete io;
 
@@ -129,25 +117,7 @@ void AnimataWindow::cleanup(void)
         rootLayer = NULL;
     }
 
-    if (allLayers) {
-        delete allLayers;
-        allLayers = NULL;
-    }
-
-    if (allBones) {
-        delete allBones;
-        allBones = NULL;
-    }
-
-    if (allJoints) {
-        delete allJoints;
-        allJoints = NULL;
-    }
-
-    if (oscJoints) {
-        delete oscJoints;
-        oscJoints = NULL;
-    }
+    clearElements();
 
     pointedVertex = pointedPrevVertex = pointedPrevPrevVertex = NULL;
     pointedFace = NULL;
@@ -159,93 +129,31 @@ void AnimataWindow::cleanup(void)
     filename[0] = 0; // empty filename
 }
 
-void AnimataWindow::addToAllLayers(Layer *l)
-{
-    allLayers->push_back(l);
-    sort(allLayers->begin(), allLayers->end(), Layer::zorder);
-}
-
-/**
- * Deletes layer from vector of all layers.
- * \param layer pointer to layer
- **/
-void AnimataWindow::deleteFromAllLayers(Layer *layer)
-{
-    vector<Layer *>::iterator pos;
-
-    // find position of layer in vector
-    pos = std::find(allLayers->begin(), allLayers->end(), layer);
-    if (pos == allLayers->end()) {
-        // not a member
-        fprintf(stderr, "error deleting %s (%x)\n", layer->getName(), layer);
-
-        return;
-    }
-
-    allLayers->erase(pos);
-}
-
-/**
- * Deletes bone from vector of all bones.
- * \param bone pointer to bone
- **/
-void AnimataWindow::deleteFromAllBones(Bone *bone)
-{
-    vector<Bone *>::iterator pos;
-
-    // find position of bone in vector
-    pos = std::find(allBones->begin(), allBones->end(), bone);
-    if (pos == allBones->end()) // not a member
-        return;
-
-    allBones->erase(pos);
-}
-
 /**
- * Deletes joint from vector of all joints.
- * \param joint pointer to joint
+ * Loads an image with FLTK and adds it to the texture manager.
+ * \param filename path of the image
+ * \return pointer to the new texture or NULL on failure
  **/
-void AnimataWindow::deleteFromAllJoints(Joint *joint)
+Texture *AnimataWindow::loadTexture(const char *filename)
 {
-    vector<Joint *>::iterator pos;
-
-    // find position of joint in vector
-    pos = std::find(allJoints->begin(), allJoints->end(), joint);
-    if (pos == allJoints->end()) // not a member
-        return;
+    ImageBox *box = ui->loadImage(filename);
+    if (box == NULL)
+        return NULL;
 
-    allJoints->erase(pos);
-}
-
-/**
- * Deletes joint from vector of OSC joints.
- * \param joint pointer to joint
- **/
-void AnimataWindow::deleteFromOSCJoints(Joint *joint)
-{
-    vector<Joint *>::iterator pos;
-
-    // find position of joint in vector
-    pos = std::find(oscJoints->begin(), oscJoints->end(), joint);
-    if (pos == oscJoints->end()) // not a member
-        return;
-
-    oscJoints->erase(pos);
+    return textureManager->createTexture(box);
 }
 
 void AnimataWindow::saveScene(const char *filename)
 {
+    lock();
     io->save(filename, rootLayer);
+    unlock();
 }
 
 void AnimataWindow::loadScene(const char *filename)
 {
+    lock();
     cleanup();
-    allLayers = new vector<Layer *>;
-    allBones = new vector<Bone *>;
-    allJoints = new vector<Joint *>;
-    oscJoints = new vector<Joint *>;
-
     Layer *layer = io->load(filename);
 
     if (layer) {
@@ -256,24 +164,16 @@ void AnimataWindow::loadScene(const char *filename)
 
         oscListener->setRootLayer(rootLayer);
 
-        sort(allLayers->begin(), allLayers->end(), Layer::zorder);
         if (ui) {
             ui->refreshLayerTree(rootLayer);
         }
     }
     else {
         /* loading error */
-        delete allLayers;
-        allLayers = NULL;
-        delete allBones;
-        allBones = NULL;
-        delete allJoints;
-        allJoints = NULL;
-        delete oscJoints;
-        oscJoints = NULL;
+        clearElements();
         newScene();
     }
-
+    unlock();
 }
 
 /**
@@ -282,6 +182,7 @@ void AnimataWindow::loadScene(const char *filename)
  **/
 void AnimataWindow::importScene(const char *filename)
 {
+    lock();
     Layer *layer = io->load(filename);
     /* if no error add the layer to the current layer's children */
     if (layer) {
@@ -303,17 +204,14 @@ void AnimataWindow::importScene(const char *filename)
     if (ui) {
         ui->refreshLayerTree(rootLayer);
     }
+    unlock();
 }
 
 void AnimataWindow::newScene(void)
 {
+    lock();
     cleanup();
 
-    allLayers = new vector<Layer *>;
-    allBones = new vector<Bone *>;
-    allJoints = new vector<Joint *>;
-    oscJoints = new vector<Joint *>;
-
     rootLayer = new Layer();
 
     cLayer = rootLayer; //->makeLayer();
@@ -329,6 +227,7 @@ void AnimataWindow::newScene(void)
         //ui->playback->setRootLayer(rootLayer);
         ui->refreshLayerTree(rootLayer);
     }
+    unlock();
 }
 
 /// Sets filename of the scene.
@@ -340,8 +239,12 @@ void AnimataWindow::setFilename(const char *filename)
 /// Calls the mesh triangulation routine.
 void AnimataWindow::triangulate(void)
 {
+    lock();
     cMesh->triangulate();
     pointedFace = NULL;
+    unlock();
+
+    invalidateFrame();
 }
 
 /**
@@ -349,7 +252,11 @@ void AnimataWindow::triangulate(void)
  **/
 void AnimataWindow::attachVertices(void)
 {
+    lock();
     cSkeleton->attachVertices(cMesh->getSelectedVertices());
+    unlock();
+
+    invalidateFrame();
 }
 
 /**
@@ -357,7 +264,11 @@ void AnimataWindow::attachVertices(void)
  **/
 void AnimataWindow::detachVertices(void)
 {
+    lock();
     cSkeleton->detachVertices();
+    unlock();
+
+    invalidateFrame();
 }
 
 /**
@@ -377,24 +288,39 @@ void AnimataWindow::drawScene(void)
     camera->setupPerspective();
     camera->setupModelView();
 
+    /* the playback window draws from the same atlas pages, its OpenGL
+     * context is shared with this one */
+    textureManager->updateAtlas();
     textureManager->draw(RENDER_FEEDBACK | RENDER_TEXTURE);
 
-    lock();
+    /* the simulation thread does not touch the layer transformations, so
+     * there is no need to wait for it */
+    updateTransformations();
+
+    drawList->draw(allLayers, RENDER_FEEDBACK | RENDER_TEXTURE);
+
     vector<Layer *>::iterator l = allLayers->begin();
     for (; l < allLayers->end(); l++) {
-        (*l)->calcTransformationMatrix();
+        (*l)->drawWithoutRecursion(RENDER_WIREFRAME);
     }
-    unlock();
+}
 
-    l = allLayers->begin();
-    for (; l < allLayers->end(); l++) {
-        (*l)->drawWithoutRecursion(RENDER_FEEDBACK | RENDER_TEXTURE);
-    }
+/**
+ * Checks whether the windows have to be drawn again, which is the case if
+ * the scene was invalidated since the last frame or the settings of the
+ * user interface have changed. Otherwise the windows keep their last frame.
+ * \return true if the frame has changed
+ **/
+bool AnimataWindow::isFrameChanged(void)
+{
+    bool changed = validateFrame();
 
-    l = allLayers->begin();
-    for (; l < allLayers->end(); l++) {
-        (*l)->drawWithoutRecursion(RENDER_WIREFRAME);
+    if (memcmp(&drawnSettings, &ui->settings, sizeof(AnimataSettings))) {
+        memcpy(&drawnSettings, &ui->settings, sizeof(AnimataSettings));
+        changed = true;
     }
+
+    return changed;
 }
 
 /**
@@ -433,19 +359,35 @@ void AnimataWindow::draw()
     }
 
     if (!valid()) {
-        setupOpenGL();
-
         camera->setSize(Vector2D(w(), h()));
 
         // recalculate picture size in playback window
         ui->playback->invalidate();
+        invalidateFrame();
     }
 
+    /* the context is shared with the playback window, which changes the
+     * clear color */
+    setupOpenGL();
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    /* run the spring model simulation on all bones of the skeleton */
+    /* draw the latest poses published by the simulation thread, the
+     * playback window draws the same ones */
+    vector<Layer *>::iterator l = allLayers->begin();
+    for (; l < allLayers->end(); l++) {
+        (*l)->latchPose();
+    }
+
+    /* show the length of the selected bones, which is changed by the
+     * simulation and over OSC */
+    vector<Bone *> *bones = cSkeleton->getBones();
+    for (unsigned i = 0; i < bones->size(); i++) {
+        Bone *b = (*bones)[i];
+        if (b->selected)
+            ui->boneLengthMult->value(b->getLengthMult());
+    }
     if (ui->settings.playSimulation == 1)
-        rootLayer->simulate(ui->settings.iteration);
+        ui->iterationCount->value(cSkeleton->getIterationCount());
 
     drawScene();
 
@@ -519,7 +461,7 @@ void AnimataWindow::draw()
     glPopMatrix();
 
     // call selection
-    selector->doPick(camera, cLayer, textureManager, mouse);
+    selector->doPick(camera, cLayer, mouse);
 }
 
 /**
@@ -556,6 +498,8 @@ void AnimataWindow::setCurrentLayer(Layer *l)
     cSkeleton = cLayer->getSkeleton();
     cMesh = cLayer->getMesh();
     cMatrix = cLayer->getTransformationMatrix();
+
+    invalidateFrame();
 }
 
 void AnimataWindow::setSelectedLayers(Layer *l, int num)
@@ -566,6 +510,8 @@ void AnimataWindow::setSelectedLayers(Layer *l, int num)
     for (int i = 0; i < num; i++, layer++) {
         selectedLayers.push_back(layer);
     }
+
+    invalidateFrame();
 }
 
 /**
@@ -592,23 +538,12 @@ void AnimataWindow::createAttachedTexture(ImageBox *box)
 
 Vector2D AnimataWindow::transformMouseToWorld(Vector2D& pos)
 {
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    camera->setupModelView();
     Matrix m(*cMatrix);
     m.rotate(cLayer->getAngle() * -1.f);
-    glMultMatrixf(m.f);
 
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    camera->setupPerspective();
-
-    Transform::setMatrices();
-
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix();
-    glMatrixMode(GL_MODELVIEW);
-    glPopMatrix();
+    Transform::setMatrices(m * camera->getModelViewMatrix(),
+                           camera->getPerspectiveMatrix(),
+                           camera->getViewport());
 
     Vector3D o = Transform::unproject(Vector3D(pos.x, pos.y, 0));
     Vector3D v = Transform::unproject(Vector3D(pos.x, pos.y, 1));
@@ -912,9 +847,11 @@ void AnimataWindow::handleMouseDrag(void)
         case ANIMATA_MODE_MESH_SELECT:
             if (pointedVertex && pointedVertex->selected) {
                 cMesh->moveSelectedVertices(worldDist);
+                cSkeleton->wake();
             }
             else if (pointedFace) {
                 pointedFace->move(worldDist);
+                cSkeleton->wake();
             }
             break;
 
@@ -969,7 +906,6 @@ void AnimataWindow::handleMouseDrag(void)
 
         case ANIMATA_MODE_LAYER_DEPTH:
             cLayer->move(Vector3D(0.0f, 0.0f, viewDist.y));
-            sort(allLayers->begin(), allLayers->end(), Layer::zorder);
             setLayerUIPrefs(cLayer);
             break;
 
@@ -990,53 +926,69 @@ void AnimataWindow::handleMouseWheel(void)
 }
 
 /**
- * Event handler.
+ * Event handler. Editing happens while the scene is locked, so it does not
+ * interfere with the simulation thread.
  **/
 int AnimataWindow::handle(int event)
 {
+    int handled = 0;
+
+    /* any event may change what the editor shows */
+    invalidateFrame();
+
+    lock();
     switch (event) {
         case FL_MOVE:
             handleMouseMotion();
-            return 1;
+            handled = 1;
+            break;
         case FL_DRAG:
             handleMouseDrag();
-            return 1;
+            handled = 1;
+            break;
         case FL_PUSH:
             if(Fl::event_button() == FL_LEFT_MOUSE) {
                 handleLeftMousePress();
-                return 1;
+                handled = 1;
             }
-            if(Fl::event_button() == FL_RIGHT_MOUSE) {
+            else if(Fl::event_button() == FL_RIGHT_MOUSE) {
                 handleRightMousePress();
-                return 1;
+                handled = 1;
             }
             break;
         case FL_RELEASE:
             if(Fl::event_button() == FL_LEFT_MOUSE) {
                 handleLeftMouseRelease();
-                return 1;
+                handled = 1;
             }
-            if(Fl::event_button() == FL_RIGHT_MOUSE) {
+            else if(Fl::event_button() == FL_RIGHT_MOUSE) {
                 handleRightMouseRelease();
-                return 1;
+                handled = 1;
             }
             break;
         case FL_MOUSEWHEEL:
             handleMouseWheel();
-            return 1;
+            handled = 1;
+            break;
         case FL_FOCUS:
-            return 1;
+            handled = 1;
+            break;
         case FL_UNFOCUS:
-            return 1;
+            handled = 1;
+            break;
         case FL_KEYDOWN:
             // FIXME: if window looses its focus, it wont get any keyboard event
             // should the main parent window check for keyboard events?
             if(Fl::event_key() == FL_Escape)
-                return 1;
+                handled = 1;
             break;
         default:
             break;
     }
+    unlock();
+
+    if (handled)
+        return 1;
 
     return Fl_Gl_Window::handle(event);
 }
@@ -1065,6 +1017,7 @@ void AnimataWindow::setJointPrefsFromUI(enum ANIMATA_PREFERENCES prefParam,
                                         void *value)
 {
     cSkeleton->setSelectedJointParameters(prefParam, value);
+    invalidateFrame();
 }
 
 /**
@@ -1093,6 +1046,7 @@ void AnimataWindow::setBonePrefsFromUI(const char *name, float stiffness,
                                        float lengthMult)
 {
     cSkeleton->setSelectedBoneParameters(name, stiffness, lengthMult, -1, -1);
+    invalidateFrame();
 }
 
 /**
@@ -1131,6 +1085,7 @@ void AnimataWindow::setAttachPrefsFromUI(float area, float falloff)
 {
     cSkeleton->setSelectedBoneParameters(NULL, FLT_EPSILON, -1, area, falloff);
     cSkeleton->selectVerticesInRange(cMesh);
+    invalidateFrame();
 }
 
 /**
@@ -1173,7 +1128,6 @@ void AnimataWindow::setLayerPrefsFromUI(enum ANIMATA_PREFERENCES prefParam,
             return;
         case PREFS_LAYER_DEPTH:
             cLayer->setPositionElement(*((float *)value), 2);
-            sort(allLayers->begin(), allLayers->end(), Layer::zorder);
             return;
         case PREFS_LAYER_OFFSET_X:
             cLayer->setOffsetElement(*((float *)value), 0);
@@ -1229,28 +1183,13 @@ void AnimataWindow::setLayerUIPrefs(Layer *l)
     }
 }
 
-/**
- * Locks shared resources.
- **/
-void AnimataWindow::lock(void)
-{
-    pthread_mutex_lock(&mutex);
-}
-
-/**
- * Unlocks shared resources.
- **/
-void AnimataWindow::unlock(void)
-{
-    pthread_mutex_unlock(&mutex);
-}
-
 void timerCallback(void *v)
 {
-    ui->editorBox->lock();
-    ui->editorBox->redraw();
-    ui->playback->redraw();
-    ui->editorBox->unlock();
+    /* nothing is drawn while the scene and the settings are unchanged */
+    if (ui->editorBox->isFrameChanged()) {
+        ui->editorBox->redraw();
+        ui->playback->redraw();
+    }
 
     usleep(1);
     Fl::repeat_timeout(1.0/ui->settings.fps, timerCallback);
@@ -46,6 +46,7 @@
 #include "Skeleton.h"
 #include "Selection.h"
 #include "TextureManager.h"
+#include "DrawList.h"
 #include "Primitives.h"
 #include "Layer.h"
 #include "IO.h"
@@ -53,113 +54,17 @@
 #include "OSCManager.h"
 #include "ImageBox.h"
 #include "Preferences.h"
+#include "Simulation.h"
+#include "AnimataSettings.h"
+#include "Context.h"
 
 using namespace std;
 
 namespace Animata
 {
 
-/**
- * Operational modes set by pressing buttons on the GUI.
- **/
-enum ANIMATA_MODES
-{
-    ANIMATA_MODE_NONE = 0,
-    /* mesh */
-    ANIMATA_MODE_CREATE_VERTEX,
-    ANIMATA_MODE_CREATE_TRIANGLE,
-    ANIMATA_MODE_TEXTURIZE,
-    ANIMATA_MODE_MESH_SELECT,
-    ANIMATA_MODE_MESH_DELETE,
-    /* skeleton */
-    ANIMATA_MODE_CREATE_JOINT,
-    ANIMATA_MODE_CREATE_BONE,
-    ANIMATA_MODE_ATTACH_VERTICES,
-    ANIMATA_MODE_SKELETON_SELECT,
-    ANIMATA_MODE_SKELETON_DELETE,
-    /* texture */
-    ANIMATA_MODE_TEXTURE_POSITION,
-    ANIMATA_MODE_TEXTURE_SCALE,
-    /* layer */
-    ANIMATA_MODE_LAYER_MOVE,
-    ANIMATA_MODE_LAYER_OFFSET,
-    ANIMATA_MODE_LAYER_SCALE,
-    ANIMATA_MODE_LAYER_DEPTH,
-    ANIMATA_MODE_LAYER_ROTATE_XY,
-    ANIMATA_MODE_LAYER_ROTATE_Z
-};
-
-inline bool isMeshMode(int mode)
-{
-    return (   mode >= ANIMATA_MODE_CREATE_VERTEX
-            && mode <= ANIMATA_MODE_MESH_DELETE);
-}
-
-inline bool isSkeletonMode(int mode)
-{
-    return (   mode >= ANIMATA_MODE_CREATE_JOINT
-            && mode <= ANIMATA_MODE_SKELETON_DELETE);
-}
-
-inline bool isTextureMode(int mode)
-{
-    return (   mode >= ANIMATA_MODE_TEXTURE_POSITION
-            && mode <= ANIMATA_MODE_TEXTURE_SCALE);
-}
-
-inline bool isLayerMode(int mode)
-{
-    return (   mode >= ANIMATA_MODE_LAYER_MOVE
-            && mode <= ANIMATA_MODE_LAYER_ROTATE_Z);
-}
-
-enum ANIMATA_DISPLAY_ELEMENTS
-{
-    DISPLAY_EDITOR_VERTEX = 0x01,
-    DISPLAY_EDITOR_TRIANGLE = 0x02,
-    DISPLAY_EDITOR_JOINT = 0x04,
-    DISPLAY_EDITOR_BONE = 0x08,
-    DISPLAY_EDITOR_TEXTURE = 0x10,
-    DISPLAY_OUTPUT_VERTEX = 0x10000,
-    DISPLAY_OUTPUT_TRIANGLE = 0x20000,
-    DISPLAY_OUTPUT_JOINT = 0x40000,
-    DISPLAY_OUTPUT_BONE = 0x80000,
-    DISPLAY_OUTPUT_TEXTURE = 0x100000
-};
-
-enum ANIMATA_RENDER_MODE
-{
-    RENDER_FEEDBACK = 0x01,
-    RENDER_SELECTION = 0x02,
-    RENDER_OUTPUT = 0x04,
-    RENDER_TEXTURE = 0x10,
-    RENDER_WIREFRAME = 0x20
-};
-
-/// Various settings coming from the GUI.
-class AnimataSettings
-{
-public:
-    enum ANIMATA_MODES mode; /**< current operational mode */
-    enum ANIMATA_MODES prevMode; /**< previous operational mode */
-
-    int playSimulation; /**< whether to run simulation or not */
-    int gravity; /**< use gravity force */
-    float gravityForce; /**< strength of gravity */
-    float gravityX; /**< x component of the gravity direction vector */
-    float gravityY; /**< y component of the gravity direction vector */
-
-    int iteration; /**< number of times to run the simulation */
-    int fps; /**< frames per second */
-    int display_elements; /**< flags to display elements in windows */
-
-    int triangulateAlphaThreshold; /**< triangulation threshold */
-
-    AnimataSettings();
-};
-
 /// Main application window class.
-class AnimataWindow : public Fl_Gl_Window
+class AnimataWindow : public Fl_Gl_Window, public Context
 {
 private:
     /** mouse coordinates */
@@ -189,23 +94,11 @@ private:
     Texture         *selectedTexture;
 
     TextureManager  *textureManager;
+    DrawList        *drawList;  /**< batches of the textured layers */
     Layer           *rootLayer; /**< the root of all the layers */
 
     vector<Layer *> selectedLayers;
 
-    /* FIXME: use multimap instead of vectors and store only named elements */
-    /* the following vectors are needed to reach the elements quickly
-     * without traversing the whole hierarcy recursively */
-    /** vector of all layers without the hierarchical structure */
-    vector<Layer *> *allLayers;
-    /** vector of all bones without the hierarchical structure */
-    vector<Bone *> *allBones;
-    /** vector of all joints without the hierarchical structure */
-    vector<Joint *> *allJoints;
-
-    /** vector of all joints needed to be send via OSC */
-    vector<Joint *> *oscJoints;
-
     Layer           *cLayer;    /**< current layer */
     Mesh            *cMesh;     /**< mesh of current layer */
     Skeleton        *cSkeleton; /**< skeleton of current layer */
@@ -218,7 +111,10 @@ private:
 
     Camera          *camera;
 
-    pthread_mutex_t mutex;
+    Simulation      *simulation;    /**< runs the simulation thread */
+
+    /** settings the last frame was drawn with */
+    AnimataSettings drawnSettings;
 
     void handleLeftMousePress(void);
     void handleRightMousePress(void);
@@ -268,6 +164,7 @@ public:
     static void setupOpenGL();
 
     void draw(void);
+    bool isFrameChanged(void);
     void triangulate(void);
 
     void attachVertices(void);
@@ -328,43 +225,7 @@ public:
      **/
     inline Layer *getRootLayer() { return rootLayer; }
 
-    /**
-     * Adds layer to vector of all layers.
-     * \param l layer pointer to add
-     **/
-    void addToAllLayers(Layer *l);
-    void deleteFromAllLayers(Layer *layer);
-    /// Returns the vector storing all layers.
-    inline vector<Layer *> *getAllLayers() { return allLayers; }
-
-    /** Adds bone to vector of all bones.
-     * \param b bone pointer to add
-     **/
-    inline void addToAllBones(Bone *b) { allBones->push_back(b); }
-    void deleteFromAllBones(Bone *bone);
-    /// Returns the vector storing all bones.
-    inline vector<Bone *> *getAllBones() { return allBones; }
-
-    /** Adds joint to vector of all joints.
-     * \param j joint pointer to add
-     **/
-    inline void addToAllJoints(Joint *j) { allJoints->push_back(j); }
-    /// Deletes joint from the vector of all joints.
-    void deleteFromAllJoints(Joint *joint);
-    /// Returns the vector storing all joints.
-    inline vector<Joint *> *getAllJoints() { return allJoints; }
-
-    /** Adds joint to vector of OSC joints.
-     * \param j joint pointer to add
-     **/
-    inline void addToOSCJoints(Joint *j) { oscJoints->push_back(j); }
-    /// Deletes joint from the vector of OSC joints.
-    void deleteFromOSCJoints(Joint *joint);
-    /// Returns the vector storing OSC joints.
-    inline vector<Joint *> *getOSCJoints() { return oscJoints; }
-
-    void lock(void);
-    void unlock(void);
+    virtual Texture *loadTexture(const char *filename);
 };
 
 class Selection;
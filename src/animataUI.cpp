@@ -364,6 +364,20 @@ void AnimataUI::cb_iteration(Fl_Value_Slider* o, void* v) {
   ((AnimataUI*)(o->parent()->parent()->parent()->user_data()))->cb_iteration_i(o,v);
 }
 
+void AnimataUI::cb_tolerance_i(Fl_Value_Slider* o, void*) {
+  settings.tolerance = (float)(o->value());
+}
+void AnimataUI::cb_tolerance(Fl_Value_Slider* o, void* v) {
+  ((AnimataUI*)(o->parent()->parent()->parent()->user_data()))->cb_tolerance_i(o,v);
+}
+
+void AnimataUI::cb_relaxation_i(Fl_Value_Slider* o, void*) {
+  settings.relaxation = (float)(o->value());
+}
+void AnimataUI::cb_relaxation(Fl_Value_Slider* o, void* v) {
+  ((AnimataUI*)(o->parent()->parent()->parent()->user_data()))->cb_relaxation_i(o,v);
+}
+
 void AnimataUI::cb_gravity_i(Fl_Light_Button* o, void*) {
   settings.gravity = o->value();
 }
@@ -388,6 +402,20 @@ void AnimataUI::cb_1(Fl_Dial* o, void* v) {
   ((AnimataUI*)(o->parent()->parent()->parent()->user_data()))->cb_1_i(o,v);
 }
 
+void AnimataUI::cb_converged_i(Fl_Light_Button* o, void*) {
+  settings.convergedSkinning = o->value();
+}
+void AnimataUI::cb_converged(Fl_Light_Button* o, void* v) {
+  ((AnimataUI*)(o->parent()->parent()->parent()->user_data()))->cb_converged_i(o,v);
+}
+
+void AnimataUI::cb_gpu_i(Fl_Light_Button* o, void*) {
+  settings.gpuSkinning = o->value();
+}
+void AnimataUI::cb_gpu(Fl_Light_Button* o, void* v) {
+  ((AnimataUI*)(o->parent()->parent()->parent()->user_data()))->cb_gpu_i(o,v);
+}
+
 void AnimataUI::cb_Add1_i(Fl_Button*, void*) {
   Flu_Tree_Browser::Node* n = layerTree->get_selected(1);
 
@@ -1175,6 +1203,46 @@ AnimataUI::AnimataUI() {
           o->callback((Fl_Callback*)cb_iteration);
           o->align(Fl_Align(FL_ALIGN_TOP_LEFT));
         } // Fl_Value_Slider* o
+        { Fl_Value_Slider* o = new Fl_Value_Slider(250, 625, 150, 17, "tolerance");
+          o->tooltip("Stop iterating when no bone is further from its length than this, 0 to alw\
+ays run all iterations.");
+          o->type(1);
+          o->box(FL_BORDER_BOX);
+          o->color((Fl_Color)30);
+          o->selection_color((Fl_Color)3);
+          o->labelsize(10);
+          o->labelcolor(FL_BACKGROUND2_COLOR);
+          o->maximum(1);
+          o->step(0.001);
+          o->textcolor(FL_BACKGROUND2_COLOR);
+          o->callback((Fl_Callback*)cb_tolerance);
+          o->align(Fl_Align(FL_ALIGN_TOP_LEFT));
+        } // Fl_Value_Slider* o
+        { Fl_Value_Slider* o = new Fl_Value_Slider(415, 625, 150, 17, "relaxation");
+          o->tooltip("Over-relaxation factor, values above 1 speed up long chains.");
+          o->type(1);
+          o->box(FL_BORDER_BOX);
+          o->color((Fl_Color)30);
+          o->selection_color((Fl_Color)3);
+          o->labelsize(10);
+          o->labelcolor(FL_BACKGROUND2_COLOR);
+          o->minimum(1);
+          o->maximum(1.9);
+          o->step(0.05);
+          o->value(1);
+          o->textcolor(FL_BACKGROUND2_COLOR);
+          o->callback((Fl_Callback*)cb_relaxation);
+          o->align(Fl_Align(FL_ALIGN_TOP_LEFT));
+        } // Fl_Value_Slider* o
+        { iterationCount = new Fl_Value_Output(580, 625, 40, 17, "passes");
+          iterationCount->tooltip("Number of iterations the current layer took in the last frame.");
+          iterationCount->box(FL_BORDER_BOX);
+          iterationCount->color((Fl_Color)30);
+          iterationCount->labelsize(10);
+          iterationCount->labelcolor(FL_BACKGROUND2_COLOR);
+          iterationCount->textcolor(FL_BACKGROUND2_COLOR);
+          iterationCount->align(Fl_Align(FL_ALIGN_TOP_LEFT));
+        } // Fl_Value_Output* iterationCount
         { Fl_Light_Button* o = new Fl_Light_Button(25, 569, 95, 20, "gravity");
           o->box(FL_BORDER_BOX);
           o->down_box(FL_BORDER_BOX);
@@ -1204,6 +1272,27 @@ AnimataUI::AnimataUI() {
           o->callback((Fl_Callback*)cb_1);
           o->angles(0, 360);
         } // Fl_Dial* o
+        { Fl_Light_Button* o = new Fl_Light_Button(190, 569, 95, 20, "converged skin");
+          o->tooltip("Pull attached vertices as far as the iterations run would. Switch off to pull th\
+em only once per frame, which makes the mesh follow the bones more loosely.");
+          o->box(FL_BORDER_BOX);
+          o->down_box(FL_BORDER_BOX);
+          o->value(1);
+          o->color((Fl_Color)30);
+          o->labelsize(10);
+          o->labelcolor(FL_BACKGROUND2_COLOR);
+          o->callback((Fl_Callback*)cb_converged);
+        } // Fl_Light_Button* o
+        { Fl_Light_Button* o = new Fl_Light_Button(300, 569, 95, 20, "gpu skin");
+          o->tooltip("Move attached vertices in a vertex shader while drawing. Falls back to the r\
+egular skinning when editing vertices or without OpenGL 2.0.");
+          o->box(FL_BORDER_BOX);
+          o->down_box(FL_BORDER_BOX);
+          o->color((Fl_Color)30);
+          o->labelsize(10);
+          o->labelcolor(FL_BACKGROUND2_COLOR);
+          o->callback((Fl_Callback*)cb_gpu);
+        } // Fl_Light_Button* o
         o->resizable(NULL);
         o->end();
       } // Fl_Group* o
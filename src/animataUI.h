@@ -27,6 +27,7 @@ extern void cb_Create(Fl_Button*, long);
 #include <FL/Fl_Check_Button.H>
 #include <FL/Fl_Value_Input.H>
 #include <FL/Fl_Light_Button.H>
+#include <FL/Fl_Value_Output.H>
 #include <FL/Fl_Dial.H>
 extern void cb_Vertex(Fl_Check_Button*, long);
 #include "Layer.h"
@@ -162,12 +163,23 @@ private:
   static void cb_play(Fl_Light_Button*, void*);
   inline void cb_iteration_i(Fl_Value_Slider*, void*);
   static void cb_iteration(Fl_Value_Slider*, void*);
+  inline void cb_tolerance_i(Fl_Value_Slider*, void*);
+  static void cb_tolerance(Fl_Value_Slider*, void*);
+  inline void cb_relaxation_i(Fl_Value_Slider*, void*);
+  static void cb_relaxation(Fl_Value_Slider*, void*);
+public:
+  Fl_Value_Output *iterationCount;
+private:
   inline void cb_gravity_i(Fl_Light_Button*, void*);
   static void cb_gravity(Fl_Light_Button*, void*);
   inline void cb__i(Fl_Value_Slider*, void*);
   static void cb_(Fl_Value_Slider*, void*);
   inline void cb_1_i(Fl_Dial*, void*);
   static void cb_1(Fl_Dial*, void*);
+  inline void cb_converged_i(Fl_Light_Button*, void*);
+  static void cb_converged(Fl_Light_Button*, void*);
+  inline void cb_gpu_i(Fl_Light_Button*, void*);
+  static void cb_gpu(Fl_Light_Button*, void*);
   inline void cb_Add1_i(Fl_Button*, void*);
   static void cb_Add1(Fl_Button*, void*);
   inline void cb_Delete_i(Fl_Button*, void*);
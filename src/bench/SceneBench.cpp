@@ -0,0 +1,363 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Benchmark of the stages of a frame on the headless core library. Each
+ * scene file is loaded, optionally replicated, and the simulation, the
+ * skinning, the layer transformations, loading, saving and triangulation
+ * are timed separately. The results are written as JSON with the mean,
+ * minimum, maximum and percentiles of the nanoseconds per sample.
+ *
+ * usage: scenebench [-c copies] [-f frames] [-i iterations] [-l loads]
+ *                   [-j threads] [-o output.json] file.nmt ...
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <map>
+#include <vector>
+#include <algorithm>
+
+#include "Context.h"
+#include "IO.h"
+#include "Layer.h"
+#include "SkeletonSolver.h"
+#include "SkinTable.h"
+#include "Texture.h"
+#include "ThreadPool.h"
+
+using namespace Animata;
+
+/** size of the placeholder textures, large enough to cover the meshes */
+#define BENCH_TEXTURE_SIZE 4096
+
+/**
+ * Context of the benchmark. Images are not decoded without the user
+ * interface, textures are replaced by opaque placeholders so the scenes
+ * keep their textures when saved and triangulated.
+ **/
+class BenchContext : public Context
+{
+public:
+    ~BenchContext()
+    {
+        for (unsigned i = 0; i < textures.size(); i++) {
+            free((void *)textures[i]->getFilename());
+            delete textures[i];
+        }
+    }
+
+    virtual Texture *loadTexture(const char *filename)
+    {
+        Texture *t = new Texture(strdup(filename),
+                                 Vector2D(BENCH_TEXTURE_SIZE,
+                                          BENCH_TEXTURE_SIZE), 3, NULL);
+        textures.push_back(t);
+        return t;
+    }
+
+private:
+    vector<Texture *> textures;
+};
+
+/// Timings of one stage of the benchmark.
+struct Stage
+{
+    Stage(const char *n) : name(n) {}
+
+    const char *name;
+    vector<double> samples; ///< nanoseconds of each sample
+};
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * Collects the layers of the hierarchy below the given layer.
+ **/
+static void collectLayers(Layer *layer, vector<Layer *> *layers)
+{
+    vector<Layer *> *sublayers = layer->getLayers();
+    for (unsigned i = 0; i < sublayers->size(); i++) {
+        layers->push_back((*sublayers)[i]);
+        collectLayers((*sublayers)[i], layers);
+    }
+}
+
+/**
+ * Builds a solver holding the current pose of the skeleton, with the
+ * joints and bones in the order of the skeleton.
+ **/
+static void buildSolver(Skeleton *skeleton, SkeletonSolver *solver)
+{
+    vector<Joint *> *joints = skeleton->getJoints();
+    vector<Bone *> *bones = skeleton->getBones();
+    map<Joint *, unsigned> index;
+
+    for (unsigned i = 0; i < joints->size(); i++) {
+        Joint *j = (*joints)[i];
+        index[j] = solver->addJoint(j->position, j->fixed);
+    }
+    for (unsigned i = 0; i < bones->size(); i++) {
+        Bone *b = (*bones)[i];
+        solver->addBone(index[b->j0], index[b->j1], b->getOrigSize());
+    }
+}
+
+static double percentile(const vector<double>& sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+    return sorted[(unsigned)(p * (sorted.size() - 1) + .5)];
+}
+
+/**
+ * Writes a string as a JSON string literal.
+ **/
+static void writeString(FILE *out, const char *s)
+{
+    fputc('"', out);
+    for (; *s; s++) {
+        if ((*s == '"') || (*s == '\\'))
+            fputc('\\', out);
+        fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+static void writeStage(FILE *out, Stage *stage, bool last)
+{
+    vector<double> sorted(stage->samples);
+    sort(sorted.begin(), sorted.end());
+
+    double sum = 0;
+    for (unsigned i = 0; i < sorted.size(); i++)
+        sum += sorted[i];
+    double mean = sorted.empty() ? 0 : sum / sorted.size();
+
+    fprintf(out, "        \"%s\": { \"samples\": %u, \"mean\": %.0f, "
+            "\"min\": %.0f, \"p50\": %.0f, \"p90\": %.0f, \"p99\": %.0f, "
+            "\"max\": %.0f }%s\n", stage->name, (unsigned)sorted.size(),
+            mean, percentile(sorted, 0), percentile(sorted, .5),
+            percentile(sorted, .9), percentile(sorted, .99),
+            percentile(sorted, 1), last ? "" : ",");
+}
+
+int main(int argc, char **argv)
+{
+    BenchContext benchContext;
+    setContext(&benchContext);
+
+    int copies = 1;
+    int frames = 100;
+    int iterations = context->getSettings()->iteration;
+    int loads = 10;
+    int threads = 0;
+    const char *output = NULL;
+
+    int i = 1;
+    for (; i < argc - 1; i += 2) {
+        if (strcmp(argv[i], "-c") == 0)
+            copies = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-f") == 0)
+            frames = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-i") == 0)
+            iterations = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-l") == 0)
+            loads = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-j") == 0)
+            threads = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-o") == 0)
+            output = argv[i + 1];
+        else
+            break;
+    }
+
+    if ((i >= argc) || (copies < 1) || (frames < 1) || (loads < 1)) {
+        fprintf(stderr, "usage: %s [-c copies] [-f frames] [-i iterations] "
+                "[-l loads] [-j threads] [-o output.json] file.nmt ...\n",
+                argv[0]);
+        return 1;
+    }
+
+    FILE *out = stdout;
+    if (output && ((out = fopen(output, "w")) == NULL)) {
+        perror(output);
+        return 1;
+    }
+
+    char savePath[] = "/tmp/scenebenchXXXXXX";
+    int fd = mkstemp(savePath);
+    if (fd < 0) {
+        perror(savePath);
+        return 1;
+    }
+    close(fd);
+
+    ThreadPool *pool = threads > 0 ? new ThreadPool(threads) : NULL;
+    IO io;
+
+    fprintf(out, "{\n  \"unit\": \"ns\",\n  \"copies\": %d,\n"
+            "  \"frames\": %d,\n  \"iterations\": %d,\n  \"loads\": %d,\n"
+            "  \"threads\": %d,\n  \"scenes\": [", copies, frames, iterations,
+            loads, threads);
+
+    bool first = true;
+    for (; i < argc; i++) {
+        Stage load("load"), save("save"), simulate("simulate"),
+              skinning("skinning"), transform("transform"),
+              triangulate("triangulate");
+
+        /* load the scene on its own first */
+        bool failed = false;
+        for (int l = 0; l < loads; l++) {
+            double start = now();
+            Layer *scene = io.load(argv[i]);
+            load.samples.push_back(now() - start);
+
+            if (scene == NULL) {
+                failed = true;
+                break;
+            }
+            delete scene;
+            context->clearElements();
+        }
+        if (failed) {
+            fprintf(stderr, "error loading %s\n", argv[i]);
+            continue;
+        }
+
+        Layer *root = new Layer();
+        for (int c = 0; c < copies; c++)
+            root->addSublayer(io.load(argv[i]));
+        root->calcTransformationMatrix();
+
+        vector<Layer *> layers;
+        collectLayers(root, &layers);
+
+        unsigned vertexCount = 0, faceCount = 0, jointCount = 0,
+                 boneCount = 0;
+        for (unsigned l = 0; l < layers.size(); l++) {
+            Mesh *m = layers[l]->getMesh();
+            Skeleton *s = layers[l]->getSkeleton();
+            vertexCount += m->getVertices()->size();
+            faceCount += m->getFaces()->size();
+            jointCount += s->getJoints()->size();
+            boneCount += s->getBones()->size();
+        }
+
+        /* the skeletons are woken up every frame to time the simulation
+         * of a scene being played with instead of one at rest */
+        for (int f = 0; f < frames; f++) {
+            for (unsigned l = 0; l < layers.size(); l++)
+                layers[l]->getSkeleton()->wake();
+
+            double start = now();
+            root->simulate(iterations, pool);
+            simulate.samples.push_back(now() - start);
+        }
+
+        /* skinning of the simulated poses on its own */
+        vector<SkeletonSolver *> solvers;
+        vector<SkinTable *> tables;
+        for (unsigned l = 0; l < layers.size(); l++) {
+            Skeleton *s = layers[l]->getSkeleton();
+            if (s->getBones()->empty())
+                continue;
+            SkeletonSolver *solver = new SkeletonSolver();
+            buildSolver(s, solver);
+            SkinTable *table = new SkinTable();
+            table->build(s->getBones());
+            solvers.push_back(solver);
+            tables.push_back(table);
+        }
+        for (int f = 0; f < frames; f++) {
+            double start = now();
+            for (unsigned t = 0; t < tables.size(); t++)
+                tables[t]->skin(solvers[t]);
+            skinning.samples.push_back(now() - start);
+        }
+        for (unsigned t = 0; t < tables.size(); t++) {
+            delete solvers[t];
+            delete tables[t];
+        }
+
+        for (int f = 0; f < frames; f++) {
+            root->setPosition(Vector2D(f & 1, 0));
+
+            double start = now();
+            root->updateTransformation();
+            transform.samples.push_back(now() - start);
+        }
+
+        for (int l = 0; l < loads; l++) {
+            double start = now();
+            io.save(savePath, root);
+            save.samples.push_back(now() - start);
+        }
+
+        for (int l = 0; l < loads; l++) {
+            double start = now();
+            for (unsigned m = 0; m < layers.size(); m++) {
+                Mesh *mesh = layers[m]->getMesh();
+                mesh->clearFaces();
+                mesh->triangulate();
+            }
+            triangulate.samples.push_back(now() - start);
+        }
+
+        delete root;
+        context->clearElements();
+
+        fprintf(out, "%s\n    {\n      \"file\": ", first ? "" : ",");
+        writeString(out, argv[i]);
+        fprintf(out, ",\n      \"layers\": %u,\n      \"vertices\": %u,\n"
+                "      \"faces\": %u,\n      \"joints\": %u,\n"
+                "      \"bones\": %u,\n      \"stages\": {\n",
+                (unsigned)layers.size(), vertexCount, faceCount, jointCount,
+                boneCount);
+        writeStage(out, &simulate, false);
+        writeStage(out, &skinning, false);
+        writeStage(out, &transform, false);
+        writeStage(out, &load, false);
+        writeStage(out, &save, false);
+        writeStage(out, &triangulate, true);
+        fprintf(out, "      }\n    }");
+        first = false;
+    }
+
+    fprintf(out, "\n  ]\n}\n");
+
+    unlink(savePath);
+    delete pool;
+    if (out != stdout)
+        fclose(out);
+
+    return 0;
+}
@@ -0,0 +1,188 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* Benchmark of the skeleton solver comparing the bone-by-bone scalar path
+ * with the color batched one. The skeletons of the given scene files are
+ * replicated to get thousands of bones.
+ *
+ * usage: solverbench [-c copies] [-f frames] [-i iterations] file.nmt ...
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+
+#include "tinyxml.h"
+#include "SkeletonSolver.h"
+
+using namespace Animata;
+
+static double now(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/**
+ * Adds the skeletons of all layers under the given XML node to the solver.
+ **/
+static void loadSkeletons(TiXmlNode *parent, SkeletonSolver *solver)
+{
+    TiXmlNode *node = NULL;
+    while ((node = parent->IterateChildren("layer", node))) {
+        TiXmlNode *skeletonNode = node->FirstChild("skeleton");
+        TiXmlNode *jointsNode = skeletonNode ?
+                                skeletonNode->FirstChild("joints") : NULL;
+        TiXmlNode *bonesNode = skeletonNode ?
+                               skeletonNode->FirstChild("bones") : NULL;
+
+        unsigned first = solver->getJointCount();
+        unsigned jointCount = 0;
+        TiXmlNode *jointNode = NULL;
+        while (jointsNode &&
+               (jointNode = jointsNode->IterateChildren(jointNode))) {
+            TiXmlElement *j = jointNode->ToElement();
+            float x = 0, y = 0;
+            int fixed = 0;
+            j->QueryFloatAttribute("x", &x);
+            j->QueryFloatAttribute("y", &y);
+            j->QueryIntAttribute("fixed", &fixed);
+            solver->addJoint(Vector2D(x, y), fixed);
+            jointCount++;
+        }
+
+        TiXmlNode *boneNode = NULL;
+        while (bonesNode &&
+               (boneNode = bonesNode->IterateChildren(boneNode))) {
+            TiXmlElement *b = boneNode->ToElement();
+            int j0 = -1, j1 = -1;
+            float size = 0;
+            b->QueryIntAttribute("j0", &j0);
+            b->QueryIntAttribute("j1", &j1);
+            b->QueryFloatAttribute("size", &size);
+            if ((j0 < 0) || (j1 < 0) || (j0 >= (int)jointCount) ||
+                (j1 >= (int)jointCount) || (j0 == j1))
+                continue;
+
+            unsigned i = solver->addBone(first + j0, first + j1, size);
+            b->QueryFloatAttribute("stiffness", &solver->damp[i]);
+            b->QueryFloatAttribute("lm", &solver->lengthMult[i]);
+            b->QueryFloatAttribute("lmmin", &solver->lengthMultMin[i]);
+            b->QueryFloatAttribute("lmmax", &solver->lengthMultMax[i]);
+            b->QueryFloatAttribute("tempo", &solver->tempo[i]);
+            b->QueryFloatAttribute("time", &solver->time[i]);
+        }
+
+        loadSkeletons(node, solver);
+    }
+}
+
+/**
+ * Runs the simulation the same way the editor does and returns the time
+ * spent in nanoseconds per frame.
+ **/
+static double run(SkeletonSolver *solver, bool batched, int frames,
+                  int iterations)
+{
+    double start = now();
+    for (int f = 0; f < frames; f++) {
+        for (int t = 0; t < iterations; t++) {
+            if (batched)
+                solver->relax();
+            else
+                solver->relaxSequential();
+        }
+    }
+    return (now() - start) * 1e9 / frames;
+}
+
+int main(int argc, char **argv)
+{
+    int copies = 100;
+    int frames = 100;
+    int iterations = 40;
+
+    int i = 1;
+    for (; i < argc - 1; i += 2) {
+        if (strcmp(argv[i], "-c") == 0)
+            copies = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-f") == 0)
+            frames = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-i") == 0)
+            iterations = atoi(argv[i + 1]);
+        else
+            break;
+    }
+
+    if (i >= argc) {
+        fprintf(stderr, "usage: %s [-c copies] [-f frames] "
+                "[-i iterations] file.nmt ...\n", argv[0]);
+        return 1;
+    }
+
+    printf("%-40s %7s %7s %12s %12s %8s %10s\n", "file", "bones", "colors",
+           "scalar ns", "batched ns", "speedup", "max diff");
+
+    for (; i < argc; i++) {
+        TiXmlDocument doc(argv[i]);
+        if (!doc.LoadFile()) {
+            fprintf(stderr, "error loading %s: %s\n", argv[i],
+                    doc.ErrorDesc());
+            continue;
+        }
+        TiXmlElement *root = doc.RootElement();
+        if (root == NULL)
+            continue;
+
+        SkeletonSolver scalar;
+        for (int c = 0; c < copies; c++)
+            loadSkeletons(root, &scalar);
+        if (scalar.getBoneCount() == 0)
+            continue;
+        SkeletonSolver batched(scalar);
+
+        double scalarTime = run(&scalar, false, frames, iterations);
+        double batchedTime = run(&batched, true, frames, iterations);
+
+        /* the two paths relax bones in a different order, so the poses
+         * differ slightly while the skeleton is still moving */
+        float maxDiff = 0;
+        for (unsigned j = 0; j < scalar.getJointCount(); j++) {
+            float dx = scalar.x[j] - batched.x[j];
+            float dy = scalar.y[j] - batched.y[j];
+            float d = sqrt(dx * dx + dy * dy);
+            if (d > maxDiff)
+                maxDiff = d;
+        }
+
+        printf("%-40s %7u %7u %12.0f %12.0f %7.2fx %10.4f\n", argv[i],
+               scalar.getBoneCount(), batched.getColorCount(), scalarTime,
+               batchedTime, scalarTime / batchedTime, maxDiff);
+    }
+
+    return 0;
+}
+